@@ -7,187 +7,3636 @@
 #include "dirent.h"
 #include <sys/stat.h>
 #include <ctype.h>
+#include <time.h>
+#include <stdint.h>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <pthread.h> // Link with -pthread on older glibc
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__)
+#include <sys/inotify.h>
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+#endif
+
+/**
+ * Longest file name kept by the student cache. Student files are named <usf id>.txt
+ */
+#define CACHE_NAME_MAX 63
+
+/**
+ * Number of bucket files in each of the student_index/name and student_index/email indexes. Must be a power of two.
+ */
+#define INDEX_BUCKETS 4096
+
+/**
+ * Size at which the log backend seals a segment file and starts a new one
+ */
+#define LOG_SEGMENT_BYTES (64L * 1024 * 1024)
+
+/**
+ * First bytes of a log segment of packed records. Older segments start straight with a record.
+ */
+#define LOG_MAGIC "SLG2"
+
+/**
+ * Bits each grade takes in a packed grade word, enough for any one digit grade
+ */
+#define GRADE_BITS 4
+
+/**
+ * First bytes of students.bin, the binary roster main.c saves, and the version of its records written by export
+ */
+#define ROSTER_MAGIC "SRBF"
+#define ROSTER_VERSION 2
+
+/**
+ * Bits each grade takes in the packed grades of a students.bin record. A grade of 5 there means none was entered.
+ */
+#define ROSTER_GRADE_BITS 3
+
+/**
+ * Changes main.c has made since it last wrote students.bin, kept in the same directory and replayed on load
+ */
+#define ROSTER_JOURNAL "students.journal"
+
+/**
+ * Threads reading student files when student_data is scanned. Reads block on the disk rather than the CPU, so this
+ * can exceed the number of cores.
+ */
+#define SCAN_THREADS 16
+
+/**
+ * Files each scan thread claims at a time
+ */
+#define SCAN_BATCH 16
+
+/**
+ * Directories with fewer files than this are scanned on one thread
+ */
+#define SCAN_MIN_FILES 64
+
+/**
+ * Most saves a group commit waits for before committing early
+ */
+#define SAVE_MAX_PENDING 256
+
+/**
+ * Longest student file a pending save holds. Three grades and six line breaks on top of the ID, name, and email.
+ */
+#define SAVE_DATA_MAX 128
+
+/**
+ * Submission queue size of the io_uring rings, and so the most files each batch opens
+ */
+#define URING_ENTRIES 256
+
+/**
+ * Bytes read from each student file by io_uring. Larger files are read with stdio.
+ */
+#define URING_READ_SIZE 256
+
+/**
+ * Set in the user data of the fsync linked to each write of a pending save, telling its completion from the write's
+ */
+#define URING_FSYNC_DATA (1ULL << 32)
+
+/**
+ * Largest student file a scan reads in one read(). Larger files are read with loadStudentFile().
+ */
+#define STUDENT_FILE_MAX 512
+
+/**
+ * Bytes of output gathered before each write to stdout
+ */
+#define OUTPUT_BUFFER_SIZE (1 << 16)
+
+/**
+ * Longest path of a student file, student_data/ab/cd/<usf id>.txt, or of its temporary file
+ */
+#define STUDENT_PATH_MAX 64
+
+/**
+ * File whose presence means new student files go in the sharded layout of student_data
+ */
+#define SHARD_MARKER "student_data/.sharded"
+
+/**
+ * Whether new student files are saved as student_data/ab/cd/<usf id>.txt instead of student_data/<usf id>.txt.
+ * Files are found in either layout, so student_data can be migrated while in use.
+ */
+bool shard_layout = false;
 
 /**
  * Pointer to the currently selected student
  */
-struct Student *selected_student = NULL;
+struct Student *selected_student = NULL;
+
+/**
+ * Student data structure
+ */
+struct Student {
+    char usf_id[10 + 1]; // +1 for null-terminator
+    char name[40 + 1]; // +1 for null-terminator
+    char email[40 + 1]; // +1 for null-terminator
+    int presentation_grade;
+    int essay_grade;
+    int term_project_grade;
+};
+
+/**
+ * A student file held in memory by the student cache
+ */
+struct CachedStudent {
+    char file_name[CACHE_NAME_MAX + 1];
+    struct Student student;
+    char usf_id_key[10 + 1]; // USF ID folded to lower case
+    char name_key[40 + 1]; // Name folded to lower case
+    char email_key[40 + 1]; // Email folded to lower case
+};
+
+/**
+ * Resident copy of every file in student_data, keyed by file name whichever layout the file is in. On Linux inotify
+ * watches on student_data and each shard directory keep it in step with the files, elsewhere the cache is disabled
+ * and every command scans the directory.
+ */
+struct CachedStudent *cache = NULL;
+int cache_count = 0;
+int cache_size = 0;
+int *cache_map = NULL; // Open addressing table of cache indexes by file name, -1 empty, -2 deleted
+int cache_map_size = 0;
+int cache_map_used = 0;
+bool cache_enabled = false;
+bool cache_ordered = true; // False once cache[] may be out of file name order, see cacheSort()
+int cache_watch = -1; // inotify file descriptor
+char (*cache_watch_paths)[6] = NULL; // Directory of each watch relative to student_data, indexed by watch descriptor
+int cache_watch_size = 0;
+int cache_root_watch = -1; // The watch on student_data itself
+
+/**
+ * A record in a log segment. The newest record for a USF ID wins. The three grades are packed in to one 16-bit
+ * word, GRADE_BITS each, so a record takes 96 bytes rather than the 112 of a version 1 record.
+ */
+struct LogRecord {
+    char op; // 'P' stores the student, 'D' deletes it
+    char usf_id[10 + 1];
+    char name[40 + 1];
+    char email[40 + 1];
+    unsigned char grades[2]; // Packed grades, low byte first, see packGrades()
+};
+
+/**
+ * A record in a segment written before grades were packed. Such segments have no LOG_MAGIC header.
+ */
+struct LogRecordV1 {
+    char op;
+    struct Student student;
+};
+
+/**
+ * Header of a students.bin roster, followed by count records of record_size bytes each, in native byte order
+ */
+struct RosterHeader {
+    char magic[4]; // ROSTER_MAGIC
+    uint32_t version;
+    uint32_t count;
+    uint32_t record_size;
+};
+
+/**
+ * A student in a version 2 students.bin roster. IDs there are main.c UIDs of 1 to 10 digits.
+ */
+struct RosterRecord {
+    char name[40 + 1];
+    char email[40 + 1];
+    char uid[10 + 1];
+    unsigned char grades[2]; // Packed grades, low byte first, ROSTER_GRADE_BITS each
+};
+
+/**
+ * A student in a version 1 students.bin roster, with a byte per grade
+ */
+struct RosterRecordV1 {
+    char name[40 + 1];
+    char email[40 + 1];
+    char uid[10 + 1];
+    unsigned char grades[3];
+};
+
+/**
+ * A segment file of the log backend, student_log/<number>.seg
+ */
+struct LogSegment {
+    int number;
+    FILE *fp; // Open for reading, NULL once the segment is compacted away
+    long records; // Records written to the segment
+    long live; // Records the offset index still points at
+    int version; // 2 if the segment starts with LOG_MAGIC and holds packed records, 1 if it holds LogRecordV1
+};
+
+/**
+ * Where the newest version of a student is in the log
+ */
+struct LogEntry {
+    char usf_id[10 + 1];
+    int segment; // Index into log_segments
+    long offset;
+};
+
+/**
+ * When saves are forced to the disk. FSYNC_NONE only renames, FSYNC_OP syncs every save before returning, and
+ * FSYNC_GROUP leaves saves pending until a group commit syncs them together.
+ */
+enum FsyncPolicy {
+    FSYNC_NONE,
+    FSYNC_OP,
+    FSYNC_GROUP
+};
+
+/**
+ * A save to be written to a temporary file in student_data and renamed over the student file when it is committed
+ */
+struct PendingSave {
+    char tmp_path[STUDENT_PATH_MAX];
+    char path[STUDENT_PATH_MAX];
+    char stale_path[STUDENT_PATH_MAX]; // A copy of the student in the other layout, removed once the save is in place
+    struct Student student;
+    char data[SAVE_DATA_MAX]; // The file contents, written when the save is committed
+    int length;
+    bool ok; // Whether the temporary file was fully written and closed
+};
+
+enum FsyncPolicy fsync_policy = FSYNC_NONE;
+int fsync_interval_ms = 20; // How often FSYNC_GROUP commits
+struct PendingSave pending_saves[SAVE_MAX_PENDING];
+int pending_count = 0;
+unsigned long save_sequence = 0; // Keeps the temporary file names of one student's pending saves apart
+bool log_dirty = false; // Whether the active log segment has records not yet synced
+bool group_thread = false; // Whether a thread is committing FSYNC_GROUP saves
+bool batch_saves = false; // Whether saves wait for commitSaves() whatever the fsync policy, as during an import
+#if !defined(_WIN32)
+pthread_mutex_t save_lock = PTHREAD_MUTEX_INITIALIZER; // Guards the pending saves and log_active
+#endif
+
+/**
+ * Log-structured storage backend, used instead of student_data when STUDENT_STORAGE=log. Students are appended to
+ * segment files and found through an in-memory offset index.
+ */
+bool log_enabled = false;
+struct LogSegment *log_segments = NULL;
+int log_segment_count = 0;
+int log_segment_size = 0;
+FILE *log_active = NULL; // The last segment, open for appending
+struct LogEntry *log_entries = NULL;
+int log_entry_count = 0;
+int log_entry_size = 0;
+int *log_map = NULL; // Open addressing table of log_entries indexes by USF ID, -1 empty, -2 deleted
+int log_map_size = 0;
+int log_map_used = 0;
+
+/**
+ * Buffers reused by every scan of student_data, so visiting a record allocates nothing once they have grown
+ */
+struct ScanArena {
+    char *names; // File names, each null-terminated
+    size_t names_used;
+    size_t names_size;
+    size_t *offsets; // Where each file name starts in names
+    struct Student *students; // The student read from each file
+    bool *loaded; // Whether each file could be read
+    int size; // Capacity of offsets, students, and loaded
+    char (*read_buffers)[URING_READ_SIZE]; // URING_ENTRIES io_uring read targets
+};
+
+struct ScanArena scan_arena = {0};
+unsigned long scan_count = 0; // Scans of student_data since the program started
+unsigned long scan_records = 0; // Records visited by those scans
+unsigned long scan_allocations = 0; // Heap allocations made by those scans
+unsigned long last_scan_records = 0;
+unsigned long last_scan_allocations = 0;
+
+/**
+ * Output waiting to be written to stdout by outputFlush()
+ */
+char output_buffer[OUTPUT_BUFFER_SIZE];
+size_t output_used = 0;
+
+/**
+ * Utility function to concatenating two strings together. If s1 = a and s2 = b, then s1 + s2 = ab
+ * @param s1 String 1
+ * @param s2 String 2
+ * @return Concatenated string
+ */
+char *concat(const char *s1, const char *s2) {
+    char *result = malloc(strlen(s1) + strlen(s2) + 1); // +1 for the null-terminator
+    if (result == NULL) {
+        printf("malloc() failed\n");
+        exit(-1);
+    }
+    strcpy(result, s1);
+    strcat(result, s2);
+    return result;
+}
+
+/**
+ * Utility function for reading a line from a stream
+ * @param stream The stream to read from
+ * @param str The buffer to read in to
+ * @param n The size of the buffer
+ * @return The amount of characters read
+ */
+int read_line(FILE *stream, char str[], int n) {
+    int ch, i = 0;
+
+    while (isspace(ch = getc(stream)));
+    if (ch == EOF) {
+        str[0] = '\0';
+        return 0;
+    }
+    str[i++] = ch;
+    while ((ch = getc(stream)) != '\n' && ch != EOF) {
+        if (i < n)
+            str[i++] = ch;
+    }
+    str[i] = '\0';
+    return i;
+}
+
+/**
+ * Loads a student from a file in student_data. This method uses malloc() so the returned value must be free()
+ * @param file_name The name of the text file to load from
+ * @return The student read from the text file
+ */
+struct Student *loadStudentFile(const char *file_name) {
+
+    // Build the file path to save the student under
+    FILE *fp;
+    char *path = concat("student_data/", file_name);
+	  fp = fopen(path, "r");      //CHANGED FROM 'fclose(path)' TO 'fopen(path, "r")'
+    free(path);
+
+    if (fp == NULL) {
+        printf("File not opened, errno = %d\n", errno);
+        return NULL;
+    }
+
+    // Allocate memory for a new student structure to read
+    struct Student *student = malloc(sizeof(struct Student));
+
+    /* Read the contents of the text file */
+    read_line(fp, student->usf_id, 10);
+    read_line(fp, student->name, 40);
+    read_line(fp, student->email, 40);
+
+    char grade_buffer[2];
+
+    read_line(fp, grade_buffer, 1);
+    student->presentation_grade = atoi(grade_buffer);
+
+    read_line(fp, grade_buffer, 1);
+    student->essay_grade = atoi(grade_buffer);
+
+    read_line(fp, grade_buffer, 1);
+    student->term_project_grade = atoi(grade_buffer);
+
+    fclose(fp);
+
+    return student;
+
+}
+
+/**
+ * Loads a student from a file. This method uses malloc() so the returned value must be free()
+ * @param file The text file to load from
+ * @return The student read from the text file
+ */
+struct Student *loadStudent(struct dirent *file) {
+    return loadStudentFile(file->d_name);
+}
+
+/**
+ * FNV-1a hash of a string, used by the cache map and to pick the shard directories of a student file
+ * @param str The string to hash
+ * @return The hash
+ */
+unsigned int cacheHash(const char *str) {
+    unsigned int hash = 2166136261u;
+    while (*str != '\0') {
+        hash = (hash ^ (unsigned char) *str++) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Creates a directory if it does not already exist
+ * @param path The directory to create
+ */
+void makeDirectory(const char *path) {
+    struct stat st = {0};
+    if (stat(path, &st) == -1) {
+        #if defined(_WIN32)
+            mkdir(path);
+        #else
+            mkdir(path, 0700);
+        #endif
+    }
+}
+
+/**
+ * Gets the file name at the end of a path
+ * @param path The path
+ * @return The part of the path after the last '/'
+ */
+const char *baseName(const char *path) {
+    const char *slash = strrchr(path, '/');
+    return slash != NULL ? slash + 1 : path;
+}
+
+/**
+ * Builds the path of a student file in either layout of student_data
+ * @param usf_id The USF ID of the student
+ * @param sharded Whether to use the sharded layout, student_data/ab/cd/<usf id>.txt where ab and cd come from a
+ * hash of the USF ID, or the flat layout, student_data/<usf id>.txt
+ * @param path The buffer to build the path in, STUDENT_PATH_MAX bytes long
+ */
+void studentPath(const char *usf_id, bool sharded, char *path) {
+    if (sharded) {
+        unsigned int hash = cacheHash(usf_id);
+        snprintf(path, STUDENT_PATH_MAX, "student_data/%02x/%02x/%s.txt", (hash >> 8) & 0xff, hash & 0xff, usf_id);
+    } else {
+        snprintf(path, STUDENT_PATH_MAX, "student_data/%s.txt", usf_id);
+    }
+}
+
+/**
+ * Builds the path of the directory holding a file
+ * @param path The path of the file
+ * @param directory The buffer to build the directory in, STUDENT_PATH_MAX bytes long
+ */
+void parentDirectory(const char *path, char *directory) {
+    size_t length = baseName(path) - path;
+    if (length == 0) {
+        strcpy(directory, ".");
+        return;
+    }
+    memcpy(directory, path, length - 1);
+    directory[length - 1] = '\0';
+}
+
+/**
+ * Checks if a directory name is one of the two hex digit shard directories of student_data
+ * @param name The directory name
+ * @return If it is a shard directory
+ */
+bool isShardName(const char *name) {
+    return isxdigit((unsigned char) name[0]) && isxdigit((unsigned char) name[1]) && name[2] == '\0';
+}
+
+/**
+ * Visits everything under a directory of student_data, descending in to shard directories
+ * @param directory The directory, relative to student_data, "" for student_data itself
+ * @param depth How many shard directories deep the directory is
+ * @param visit Called with the path relative to student_data of each file and shard directory
+ * @param context Passed to visit
+ */
+void walkDirectory(const char *directory, int depth, void (*visit)(const char *path, bool is_directory,
+                                                                     void *context), void *context) {
+    char path[STUDENT_PATH_MAX];
+    DIR *dir;
+    struct dirent *ent;
+
+    snprintf(path, sizeof(path), "student_data/%s", directory);
+    if ((dir = opendir(path)) == NULL) {
+        return;
+    }
+    while ((ent = readdir(dir)) != NULL) {
+        // Leave room to put "student_data/" in front again
+        if (snprintf(path, sizeof(path), "%s%s%s", directory, directory[0] != '\0' ? "/" : "", ent->d_name) >=
+            (int) (sizeof(path) - strlen("student_data/"))) {
+            continue;
+        }
+        if (ent->d_type == DT_REG) { // Files only
+            visit(path, false, context);
+        } else if (ent->d_type == DT_DIR && depth < 2 && isShardName(ent->d_name)) {
+            visit(path, true, context);
+            walkDirectory(path, depth + 1, visit, context);
+        }
+    }
+    closedir(dir);
+}
+
+/**
+ * Visits every file and shard directory in student_data, whichever layout each student file is in
+ * @param visit Called with the path relative to student_data of each file and shard directory
+ * @param context Passed to visit
+ */
+void walkStudentData(void (*visit)(const char *path, bool is_directory, void *context), void *context) {
+    walkDirectory("", 0, visit, context);
+}
+
+/**
+ * Saves new student files in the sharded layout from now on, and leaves SHARD_MARKER so later runs do too
+ */
+void useShardLayout() {
+    struct stat st = {0};
+    if (stat(SHARD_MARKER, &st) == -1) {
+        FILE *fp = fopen(SHARD_MARKER, "w");
+        if (fp != NULL) {
+            fclose(fp);
+        }
+    }
+    shard_layout = true;
+}
+
+/**
+ * Picks the layout new student files are saved in: sharded if student_data holds SHARD_MARKER or STUDENT_LAYOUT is
+ * "sharded", otherwise flat
+ */
+void openLayout() {
+    struct stat st = {0};
+    const char *layout = getenv("STUDENT_LAYOUT");
+    if ((layout != NULL && strcasecmp(layout, "sharded") == 0) || stat(SHARD_MARKER, &st) == 0) {
+        useShardLayout();
+    }
+}
+
+/**
+ * Utility function for reading a line from a buffer, the same way read_line() reads one from a stream
+ * @param pos The position to read from, moved past the line
+ * @param end The end of the buffer
+ * @param str The buffer to read in to
+ * @param n The size of the buffer
+ * @return The amount of characters read
+ */
+int scan_line(const char **pos, const char *end, char str[], int n) {
+    const char *ptr = *pos;
+    int i = 0;
+
+    while (ptr < end && isspace((unsigned char) *ptr)) {
+        ptr++;
+    }
+    while (ptr < end && *ptr != '\n') {
+        if (i < n)
+            str[i++] = *ptr;
+        ptr++;
+    }
+    if (ptr < end) {
+        ptr++; // Skip the '\n'
+    }
+    str[i] = '\0';
+    *pos = ptr;
+    return i;
+}
+
+/**
+ * Parses the contents of a student file already read in to memory
+ * @param data The contents of the file
+ * @param length The length of the contents
+ * @param student The student to fill in
+ */
+void parseStudent(const char *data, int length, struct Student *student) {
+    const char *pos = data;
+    const char *end = data + length;
+    char grade_buffer[2];
+
+    scan_line(&pos, end, student->usf_id, 10);
+    scan_line(&pos, end, student->name, 40);
+    scan_line(&pos, end, student->email, 40);
+
+    scan_line(&pos, end, grade_buffer, 1);
+    student->presentation_grade = atoi(grade_buffer);
+
+    scan_line(&pos, end, grade_buffer, 1);
+    student->essay_grade = atoi(grade_buffer);
+
+    scan_line(&pos, end, grade_buffer, 1);
+    student->term_project_grade = atoi(grade_buffer);
+}
+
+/**
+ * Grows a buffer used by scans, counting the allocation
+ * @param ptr The buffer, or NULL
+ * @param size The new size in bytes
+ * @return The grown buffer
+ */
+void *scanGrow(void *ptr, size_t size) {
+    ptr = realloc(ptr, size);
+    if (ptr == NULL) {
+        printf("malloc() failed\n");
+        exit(-1);
+    }
+    scan_allocations++;
+    last_scan_allocations++;
+    return ptr;
+}
+
+/**
+ * Gets the name of a file collected by scanDirectory()
+ * @param index The index of the file
+ * @return The file name, valid until the next scan
+ */
+const char *scanName(int index) {
+    return scan_arena.names + scan_arena.offsets[index];
+}
+
+/**
+ * Reads a student file with one read() in to a buffer on the stack and parses it there
+ * @param dir_fd student_data, opened for openat()
+ * @param file_name The name of the file
+ * @param student The student to fill in
+ * @return If the file could be read
+ */
+bool readStudentFile(int dir_fd, const char *file_name, struct Student *student) {
+    char buffer[STUDENT_FILE_MAX];
+    int length = 0;
+#if defined(_WIN32)
+    char path[STUDENT_PATH_MAX];
+    (void) dir_fd;
+    snprintf(path, sizeof(path), "student_data/%s", file_name);
+    FILE *fp = fopen(path, "rb");
+    if (fp != NULL) {
+        length = (int) fread(buffer, 1, sizeof(buffer), fp);
+        fclose(fp);
+    }
+    if (fp == NULL) {
+#else
+    int fd = openat(dir_fd, file_name, O_RDONLY);
+    if (fd != -1) {
+        ssize_t result;
+        while (length < (int) sizeof(buffer) &&
+               (result = read(fd, buffer + length, sizeof(buffer) - length)) != 0) {
+            if (result < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            length += (int) result;
+        }
+        close(fd);
+    }
+    if (fd == -1) {
+#endif
+        printf("File not opened, errno = %d\n", errno);
+        return false;
+    }
+    if (length == (int) sizeof(buffer)) {
+        // Too big for the buffer, so take the slow path
+        struct Student *loaded = loadStudentFile(file_name);
+        scan_allocations++;
+        last_scan_allocations++;
+        if (loaded == NULL) {
+            return false;
+        }
+        *student = *loaded;
+        free(loaded);
+        return true;
+    }
+    parseStudent(buffer, length, student);
+    return true;
+}
+
+#if defined(HAVE_IO_URING)
+/**
+ * An io_uring instance driven through the raw system calls
+ */
+struct Uring {
+    int fd;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ring;
+    void *cq_ring;
+    size_t sq_ring_size;
+    size_t cq_ring_size;
+    size_t sqes_size;
+    int state; // 0 until the ring is first used, 1 if it works, -1 to use stdio instead
+};
+
+struct Uring load_ring = {0}; // Used by the main thread to read student files
+struct Uring save_ring = {0}; // Used under save_lock to write pending saves
+
+/**
+ * Sets up a ring on first use and checks the kernel supports every operation used here
+ * @param ring The ring
+ * @return If the ring can be used
+ */
+bool uringReady(struct Uring *ring) {
+    if (ring->state != 0) {
+        return ring->state == 1;
+    }
+    ring->state = -1;
+    const char *setting = getenv("STUDENT_IO_URING");
+    if (setting != NULL && strcmp(setting, "0") == 0) {
+        return false;
+    }
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring->fd = (int) syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+    if (ring->fd < 0) {
+        return false;
+    }
+
+    // Ask which operations this kernel has
+    size_t probe_size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = calloc(1, probe_size);
+    int needed[] = {IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_WRITE, IORING_OP_FSYNC, IORING_OP_CLOSE};
+    bool supported = probe != NULL && syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_PROBE, probe, 256) == 0;
+    for (int i = 0; supported && i < (int) (sizeof(needed) / sizeof(needed[0])); i++) {
+        supported = needed[i] <= probe->last_op && (probe->ops[needed[i]].flags & IO_URING_OP_SUPPORTED);
+    }
+    free(probe);
+
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_ring_size > ring->sq_ring_size) {
+            ring->sq_ring_size = ring->cq_ring_size;
+        }
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+    ring->sq_ring = MAP_FAILED;
+    ring->cq_ring = MAP_FAILED;
+    ring->sqes = MAP_FAILED;
+    if (supported) {
+        ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                             IORING_OFF_SQ_RING);
+        ring->cq_ring = (params.features & IORING_FEAT_SINGLE_MMAP) ? ring->sq_ring :
+                        mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                             IORING_OFF_CQ_RING);
+        ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                          IORING_OFF_SQES);
+    }
+    if (ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED) {
+        if (ring->sqes != MAP_FAILED) {
+            munmap(ring->sqes, ring->sqes_size);
+        }
+        if (ring->cq_ring != MAP_FAILED && ring->cq_ring != ring->sq_ring) {
+            munmap(ring->cq_ring, ring->cq_ring_size);
+        }
+        if (ring->sq_ring != MAP_FAILED) {
+            munmap(ring->sq_ring, ring->sq_ring_size);
+        }
+        close(ring->fd);
+        return false;
+    }
+
+    char *sq = ring->sq_ring;
+    char *cq = ring->cq_ring;
+    ring->sq_head = (unsigned *) (sq + params.sq_off.head);
+    ring->sq_tail = (unsigned *) (sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *) (sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *) (sq + params.sq_off.array);
+    ring->cq_head = (unsigned *) (cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *) (cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *) (cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+    ring->state = 1;
+    return true;
+}
+
+/**
+ * Takes the next free submission queue entry. At most URING_ENTRIES entries may be queued between submits.
+ * @param ring The ring
+ * @param user_data Returned with the completion of the entry
+ * @return The cleared entry
+ */
+struct io_uring_sqe *uringEntry(struct Uring *ring, unsigned long long user_data) {
+    unsigned tail = *ring->sq_tail;
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data = user_data;
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    return sqe;
+}
+
+/**
+ * Submits the queued entries without waiting for them, submitting again until the kernel has taken them all. A ring
+ * that fails to submit is not used again.
+ * @param ring The ring
+ * @param count The number of entries queued since the last submit
+ * @return The number of entries the kernel took, in queue order. Less than count if submitting failed, and only
+ * that many completions will arrive.
+ */
+unsigned uringSubmit(struct Uring *ring, unsigned count) {
+    unsigned submitted = 0;
+    while (submitted < count) {
+        long result = syscall(__NR_io_uring_enter, ring->fd, count - submitted, 0, 0, NULL, 0);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            ring->state = -1;
+            break;
+        }
+        submitted += result;
+    }
+    return submitted;
+}
+
+/**
+ * Takes the next completion, waiting for one to arrive if none has yet. Waiting is retried when interrupted, but
+ * any other failure stops the ring from being used again, and the completions still due are abandoned.
+ * @param ring The ring
+ * @param user_data Set to the user data of the completed entry
+ * @param result Set to the result of the operation, a negated errno value on failure
+ * @return If a completion arrived, otherwise the caller must finish the work itself
+ */
+bool uringComplete(struct Uring *ring, unsigned long long *user_data, int *result) {
+    unsigned head = *ring->cq_head;
+    while (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        if (syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 &&
+            errno != EINTR && errno != EAGAIN) {
+            ring->state = -1;
+            return false;
+        }
+    }
+    struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+    *result = cqe->res;
+    *user_data = cqe->user_data;
+    __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * Closes the files a batch opened through the ring, and directly any the ring does not take
+ * @param ring The ring, or NULL to close every file directly
+ * @param fds The file descriptors of the batch, negative for files that did not open
+ * @param count The number of entries in fds
+ * @return If the ring closed every file
+ */
+bool uringCloseFiles(struct Uring *ring, int *fds, int count) {
+    unsigned long long i;
+    int result;
+    unsigned closes = 0;
+    for (int j = 0; ring != NULL && j < count; j++) {
+        if (fds[j] >= 0) {
+            struct io_uring_sqe *sqe = uringEntry(ring, j);
+            sqe->opcode = IORING_OP_CLOSE;
+            sqe->fd = fds[j];
+            closes++;
+        }
+    }
+    unsigned submitted = closes > 0 ? uringSubmit(ring, closes) : 0;
+    unsigned completed = 0;
+    while (completed < submitted && uringComplete(ring, &i, &result)) {
+        completed++;
+    }
+
+    // The kernel takes entries in queue order, so the files past the first submitted closes are still open
+    unsigned queued = 0;
+    for (int j = 0; j < count; j++) {
+        if (fds[j] >= 0 && queued++ >= submitted) {
+            close(fds[j]);
+        }
+    }
+    return completed == closes;
+}
+
+/**
+ * Loads the files collected by scanDirectory() through io_uring. Each batch of up to URING_ENTRIES files is
+ * opened, read, and closed with three submissions, and each file is parsed as its read completes. Files larger
+ * than URING_READ_SIZE are read with readStudentFile() instead.
+ * @param count The number of files
+ * @return If io_uring was used, otherwise the caller must load the files itself
+ */
+bool uringLoadStudents(int count) {
+    struct Uring *ring = &load_ring;
+    if (!uringReady(ring)) {
+        return false;
+    }
+    int dir_fd = open("student_data", O_RDONLY | O_DIRECTORY);
+    if (dir_fd == -1) {
+        return false;
+    }
+
+    int fds[URING_ENTRIES];
+    if (scan_arena.read_buffers == NULL) {
+        scan_arena.read_buffers = scanGrow(NULL, sizeof(*scan_arena.read_buffers) * URING_ENTRIES);
+    }
+    char (*buffers)[URING_READ_SIZE] = scan_arena.read_buffers;
+    unsigned long long i;
+    int result;
+    bool ok = true;
+
+    for (int first = 0; ok && first < count; first += URING_ENTRIES) {
+        int batch = count - first < URING_ENTRIES ? count - first : URING_ENTRIES;
+
+        // Open every file in the batch
+        for (int j = 0; j < batch; j++) {
+            fds[j] = -1;
+            struct io_uring_sqe *sqe = uringEntry(ring, j);
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = dir_fd;
+            sqe->addr = (unsigned long) scanName(first + j);
+            sqe->open_flags = O_RDONLY;
+        }
+        unsigned submitted = uringSubmit(ring, batch);
+        unsigned completed = 0;
+        while (completed < submitted && uringComplete(ring, &i, &result)) {
+            fds[i] = result;
+            completed++;
+        }
+        if (completed < (unsigned) batch) {
+            uringCloseFiles(NULL, fds, batch);
+            ok = false;
+            break;
+        }
+
+        // Read the files that opened
+        unsigned reads = 0;
+        for (int j = 0; j < batch; j++) {
+            if (fds[j] >= 0) {
+                struct io_uring_sqe *sqe = uringEntry(ring, j);
+                sqe->opcode = IORING_OP_READ;
+                sqe->fd = fds[j];
+                sqe->addr = (unsigned long) buffers[j];
+                sqe->len = URING_READ_SIZE;
+                reads++;
+            } else {
+                // Reports why the file did not open
+                scan_arena.loaded[first + j] = readStudentFile(dir_fd, scanName(first + j),
+                                                               &scan_arena.students[first + j]);
+            }
+        }
+        submitted = uringSubmit(ring, reads);
+        completed = 0;
+        while (completed < submitted && uringComplete(ring, &i, &result)) {
+            completed++;
+            if (result >= 0 && result < URING_READ_SIZE) {
+                parseStudent(buffers[i], result, &scan_arena.students[first + i]);
+                scan_arena.loaded[first + i] = true;
+            } else {
+                scan_arena.loaded[first + i] = readStudentFile(dir_fd, scanName(first + i),
+                                                               &scan_arena.students[first + i]);
+            }
+        }
+        if (completed < reads) {
+            uringCloseFiles(NULL, fds, batch);
+            ok = false;
+            break;
+        }
+
+        // Close them again
+        ok = uringCloseFiles(ring, fds, batch);
+    }
+
+    close(dir_fd);
+    return ok;
+}
+
+/**
+ * Writes pending saves to their temporary files through io_uring, opening, writing, and closing each batch of up
+ * to URING_ENTRIES / 2 files with three submissions. With an fsync policy each write is linked to an fsync.
+ * @param saves The pending saves
+ * @param count The number of pending saves
+ * @return If every file was written, otherwise the caller must write them itself
+ */
+bool uringWriteSaves(struct PendingSave *saves, int count) {
+    struct Uring *ring = &save_ring;
+    if (!uringReady(ring)) {
+        return false;
+    }
+
+    int fds[URING_ENTRIES / 2];
+    unsigned long long i;
+    int result;
+    bool ok = true;
+
+    for (int first = 0; ok && first < count; first += URING_ENTRIES / 2) {
+        int batch = count - first < URING_ENTRIES / 2 ? count - first : URING_ENTRIES / 2;
+
+        for (int j = 0; j < batch; j++) {
+            fds[j] = -1;
+            struct io_uring_sqe *sqe = uringEntry(ring, j);
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = (unsigned long) saves[first + j].tmp_path;
+            sqe->open_flags = O_WRONLY | O_CREAT | O_TRUNC;
+            sqe->len = 0644;
+        }
+        unsigned submitted = uringSubmit(ring, batch);
+        unsigned completed = 0;
+        while (completed < submitted && uringComplete(ring, &i, &result)) {
+            fds[i] = result;
+            if (result < 0) {
+                ok = false;
+            }
+            completed++;
+        }
+        if (completed < (unsigned) batch) {
+            ok = false;
+        }
+
+        unsigned writes = 0;
+        for (int j = 0; ok && j < batch; j++) {
+            struct io_uring_sqe *sqe = uringEntry(ring, j);
+            sqe->opcode = IORING_OP_WRITE;
+            sqe->fd = fds[j];
+            sqe->addr = (unsigned long) saves[first + j].data;
+            sqe->len = saves[first + j].length;
+            writes++;
+            if (fsync_policy != FSYNC_NONE) {
+                sqe->flags = IOSQE_IO_LINK;
+                sqe = uringEntry(ring, j | URING_FSYNC_DATA);
+                sqe->opcode = IORING_OP_FSYNC;
+                sqe->fd = fds[j];
+                writes++;
+            }
+        }
+        // A write that stopped short leaves a truncated file, as much a failure as an error
+        submitted = writes > 0 ? uringSubmit(ring, writes) : 0;
+        completed = 0;
+        while (completed < submitted && uringComplete(ring, &i, &result)) {
+            if (result < 0 || (!(i & URING_FSYNC_DATA) && result != saves[first + i].length)) {
+                ok = false;
+            }
+            completed++;
+        }
+        if (completed < writes) {
+            ok = false;
+        }
+
+        // Every file that opened is closed, through the ring unless it has failed
+        if (!uringCloseFiles(ring->state == 1 ? ring : NULL, fds, batch)) {
+            ok = false;
+        }
+    }
+
+    // Operations the ring gave up waiting for may still reach these temporary files, so the caller writes new ones
+    for (int j = 0; !ok && j < count; j++) {
+        size_t length = strlen(saves[j].tmp_path) - strlen(".tmp");
+        if (length + strlen(".1.tmp") < sizeof(saves[j].tmp_path)) {
+            remove(saves[j].tmp_path);
+            strcpy(saves[j].tmp_path + length, ".1.tmp");
+        }
+    }
+    return ok;
+}
+#endif
+
+/**
+ * Takes the lock shared with the group commit thread
+ */
+void lockSaves() {
+#if !defined(_WIN32)
+    pthread_mutex_lock(&save_lock);
+#endif
+}
+
+/**
+ * Releases the lock shared with the group commit thread
+ */
+void unlockSaves() {
+#if !defined(_WIN32)
+    pthread_mutex_unlock(&save_lock);
+#endif
+}
+
+/**
+ * Flushes a file and waits for its contents to reach the disk
+ * @param fp The file
+ * @return If the contents reached the disk
+ */
+bool syncFile(FILE *fp) {
+    if (fflush(fp) != 0) {
+        return false;
+    }
+#if defined(_WIN32)
+    return _commit(_fileno(fp)) == 0;
+#else
+    return fsync(fileno(fp)) == 0;
+#endif
+}
+
+/**
+ * Waits for the entries of a directory to reach the disk, so a file renamed or removed in it stays that way after
+ * a crash. Windows has no equivalent, so this does nothing there.
+ * @param path The directory
+ */
+void syncDirectory(const char *path) {
+#if !defined(_WIN32)
+    int fd = open(path, O_RDONLY);
+    if (fd != -1) {
+        fsync(fd);
+        close(fd);
+    }
+#else
+    (void) path;
+#endif
+}
+
+/**
+ * Moves a written temporary file over the student file it replaces. A temporary file that was not fully written is
+ * removed instead, leaving the student file as it was.
+ * @param pending The save to finish
+ * @return If the student file was replaced
+ */
+bool finishSave(struct PendingSave *pending) {
+    if (!pending->ok) {
+        remove(pending->tmp_path);
+        printf("Error saving file for %s!\n", pending->student.usf_id);
+        return false;
+    }
+#if defined(_WIN32)
+    remove(pending->path); // rename() does not replace an existing file on Windows
+#endif
+    if (rename(pending->tmp_path, pending->path) != 0) {
+        remove(pending->tmp_path);
+        printf("Error saving file for %s!\n", pending->student.usf_id);
+        return false;
+    }
+    if (pending->stale_path[0] != '\0') {
+        remove(pending->stale_path);
+    }
+    return true;
+}
+
+/**
+ * Creates the shard directories a student file in the sharded layout goes in. With an fsync policy the parent of
+ * each new directory is synced so the directory survives a crash.
+ * @param path The path of the student file
+ */
+void makeShardDirectories(const char *path) {
+    char directory[STUDENT_PATH_MAX];
+    struct stat st = {0};
+    for (const char *slash = strchr(path + strlen("student_data/"), '/'); slash != NULL;
+         slash = strchr(slash + 1, '/')) {
+        memcpy(directory, path, slash - path);
+        directory[slash - path] = '\0';
+        if (stat(directory, &st) == -1) {
+            makeDirectory(directory);
+            if (fsync_policy != FSYNC_NONE) {
+                char parent[STUDENT_PATH_MAX];
+                parentDirectory(directory, parent);
+                syncDirectory(parent);
+            }
+        }
+    }
+}
+
+#if !defined(_WIN32)
+/**
+ * Starts a worker thread with SIGINT blocked, so the signal always reaches the main thread and interrupts its wait
+ * for the next command
+ * @param thread Set to the new thread
+ * @param worker The function the thread runs
+ * @param arg The argument passed to worker
+ * @return 0, or the error pthread_create() returned
+ */
+int startThread(pthread_t *thread, void *(*worker)(void *), void *arg) {
+    sigset_t block, previous;
+    sigemptyset(&block);
+    sigaddset(&block, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &block, &previous);
+    int result = pthread_create(thread, NULL, worker, arg);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    return result;
+}
+#endif
+
+/**
+ * Work shared by the threads writing pending saves to their temporary files, claimed SCAN_BATCH saves at a time
+ */
+struct WriteJob {
+    struct PendingSave *saves;
+    int count;
+    int next;
+#if !defined(_WIN32)
+    pthread_mutex_t lock;
+#endif
+};
+
+/**
+ * Writes saves claimed from a write job to their temporary files until the job is done, recording in each save
+ * whether it was fully written. A failure is left for finishSave() to report, as other writes are still in flight.
+ * @param arg The write job
+ * @return NULL
+ */
+void *writeWorker(void *arg) {
+    struct WriteJob *job = arg;
+    while (true) {
+#if !defined(_WIN32)
+        pthread_mutex_lock(&job->lock);
+#endif
+        int first = job->next;
+        job->next += SCAN_BATCH;
+#if !defined(_WIN32)
+        pthread_mutex_unlock(&job->lock);
+#endif
+        if (first >= job->count) {
+            return NULL;
+        }
+        int last = first + SCAN_BATCH < job->count ? first + SCAN_BATCH : job->count;
+        for (int i = first; i < last; i++) {
+            struct PendingSave *save = &job->saves[i];
+            FILE *fp = fopen(save->tmp_path, "w");
+            save->ok = fp != NULL;
+            if (fp == NULL) {
+                continue;
+            }
+            if (fwrite(save->data, 1, save->length, fp) != (size_t) save->length) {
+                save->ok = false;
+            }
+            if (fsync_policy != FSYNC_NONE && !syncFile(fp)) {
+                save->ok = false;
+            }
+            if (fclose(fp) != 0) {
+                save->ok = false;
+            }
+        }
+    }
+}
+
+/**
+ * Writes pending saves to their temporary files with up to SCAN_THREADS writes in flight. Small groups are written
+ * on the calling thread.
+ * @param saves The pending saves
+ * @param count The number of pending saves
+ */
+void writeSaves(struct PendingSave *saves, int count) {
+    struct WriteJob job;
+    job.saves = saves;
+    job.count = count;
+    job.next = 0;
+#if !defined(_WIN32)
+    int started = 0;
+    pthread_t threads[SCAN_THREADS];
+    pthread_mutex_init(&job.lock, NULL);
+    while (count >= SCAN_MIN_FILES && started < SCAN_THREADS &&
+           startThread(&threads[started], writeWorker, &job) == 0) {
+        started++;
+    }
+#endif
+    // Whatever no thread was started for is written here
+    writeWorker(&job);
+#if !defined(_WIN32)
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&job.lock);
+#endif
+}
+
+/**
+ * Makes every pending save durable and visible as one group: each temporary file is written and synced, in
+ * batches through io_uring where the kernel has it and otherwise on several threads, all of them are renamed in
+ * the order they were saved, then each directory they were renamed in is synced once for the whole group. A save
+ * that could not be written is reported and its student file left as it was.
+ * @return If every pending save was written
+ */
+bool commitSaves() {
+    bool ok = true;
+    lockSaves();
+    if (pending_count > 0) {
+#if defined(HAVE_IO_URING)
+        bool written = uringWriteSaves(pending_saves, pending_count);
+#else
+        bool written = false;
+#endif
+        if (!written) {
+            writeSaves(pending_saves, pending_count);
+        } else {
+            for (int i = 0; i < pending_count; i++) {
+                pending_saves[i].ok = true;
+            }
+        }
+        for (int i = 0; i < pending_count; i++) {
+            if (!finishSave(&pending_saves[i])) {
+                ok = false;
+            }
+        }
+
+        // Sync each directory once, however many of the saves landed in it
+        char directory[STUDENT_PATH_MAX];
+        char other[STUDENT_PATH_MAX];
+        for (int i = 0; fsync_policy != FSYNC_NONE && i < pending_count; i++) {
+            parentDirectory(pending_saves[i].path, directory);
+            bool synced = false;
+            for (int j = 0; j < i && !synced; j++) {
+                parentDirectory(pending_saves[j].path, other);
+                synced = strcmp(directory, other) == 0;
+            }
+            if (!synced) {
+                syncDirectory(directory);
+            }
+            // A copy in the other layout is rare, so its directory is synced without checking for repeats
+            if (pending_saves[i].stale_path[0] != '\0') {
+                parentDirectory(pending_saves[i].stale_path, directory);
+                syncDirectory(directory);
+            }
+        }
+        pending_count = 0;
+    }
+    if (log_dirty) {
+        syncFile(log_active);
+        log_dirty = false;
+    }
+    unlockSaves();
+    return ok;
+}
+
+/**
+ * Finds the newest save of a student that has not been committed yet
+ * @param usf_id The USF ID of the student
+ * @param student Set to the pending version of the student if there is one
+ * @return If a save is pending
+ */
+bool findPendingSave(const char *usf_id, struct Student *student) {
+    bool found = false;
+    lockSaves();
+    for (int i = pending_count - 1; i >= 0; i--) {
+        if (strcmp(pending_saves[i].student.usf_id, usf_id) == 0) {
+            *student = pending_saves[i].student;
+            found = true;
+            break;
+        }
+    }
+    unlockSaves();
+    return found;
+}
+
+/**
+ * Removes a temporary file left in student_data by a crash
+ * @param path The path of a file or shard directory relative to student_data
+ * @param is_directory If it is a shard directory
+ * @param context Unused
+ */
+void removeTemporaryFile(const char *path, bool is_directory, void *context) {
+    (void) context;
+    const char *name = baseName(path);
+    size_t length = strlen(name);
+    if (!is_directory && name[0] == '.' && length > 4 && strcmp(name + length - 4, ".tmp") == 0) {
+        char *full_path = concat("student_data/", path);
+        remove(full_path);
+        free(full_path);
+    }
+}
+
+#if !defined(_WIN32)
+/**
+ * Commits the pending saves every fsync_interval_ms milliseconds
+ * @param arg Unused
+ * @return Never returns
+ */
+void *groupCommitWorker(void *arg) {
+    (void) arg;
+    struct timespec interval;
+    interval.tv_sec = fsync_interval_ms / 1000;
+    interval.tv_nsec = (fsync_interval_ms % 1000) * 1000000L;
+    while (true) {
+        nanosleep(&interval, NULL);
+        commitSaves();
+    }
+    return NULL;
+}
+#endif
+
+/**
+ * Reads the fsync policy from STUDENT_FSYNC (none, op, or group) and the group commit interval in milliseconds
+ * from STUDENT_FSYNC_MS, removes temporary files left by a crash, and starts the group commit thread if it is
+ * needed. Without a thread, as on Windows, group saves are committed before each command.
+ */
+void openSaves() {
+    const char *policy = getenv("STUDENT_FSYNC");
+    const char *interval = getenv("STUDENT_FSYNC_MS");
+    if (policy != NULL && strcasecmp(policy, "op") == 0) {
+        fsync_policy = FSYNC_OP;
+    } else if (policy != NULL && strcasecmp(policy, "group") == 0) {
+        fsync_policy = FSYNC_GROUP;
+    }
+    if (interval != NULL && atoi(interval) > 0) {
+        fsync_interval_ms = atoi(interval);
+    }
+
+    // Temporary files left by a crash were never committed, so the student files they replace are still current
+    walkStudentData(removeTemporaryFile, NULL);
+#if !defined(_WIN32)
+    pthread_t thread;
+    if (fsync_policy == FSYNC_GROUP && startThread(&thread, groupCommitWorker, NULL) == 0) {
+        pthread_detach(thread);
+        group_thread = true;
+    }
+#endif
+}
+
+/**
+ * Orders the offsets of file paths in scan_arena for qsort() by file name, putting a file in the sharded layout
+ * ahead of a file of the same name in the flat layout
+ */
+int compareFileNames(const void *a, const void *b) {
+    const char *path_a = scan_arena.names + *(const size_t *) a;
+    const char *path_b = scan_arena.names + *(const size_t *) b;
+    const char *name_a = baseName(path_a);
+    const char *name_b = baseName(path_b);
+    int result = strcmp(name_a, name_b);
+    if (result == 0) {
+        result = (name_b != path_b) - (name_a != path_a);
+    }
+    return result;
+}
+
+/**
+ * Adds the path of a student file to scan_arena
+ * @param path The path of a file or shard directory relative to student_data
+ * @param is_directory If it is a shard directory
+ * @param context The number of paths collected so far
+ */
+void scanVisit(const char *path, bool is_directory, void *context) {
+    int *count = context;
+    if (!is_directory && baseName(path)[0] != '.') { // Student files only, not temporary files or the marker
+        size_t length = strlen(path) + 1;
+        if (*count == scan_arena.size) {
+            scan_arena.size = scan_arena.size == 0 ? 64 : scan_arena.size * 2;
+            scan_arena.offsets = scanGrow(scan_arena.offsets, sizeof(size_t) * scan_arena.size);
+            scan_arena.students = scanGrow(scan_arena.students, sizeof(struct Student) * scan_arena.size);
+            scan_arena.loaded = scanGrow(scan_arena.loaded, sizeof(bool) * scan_arena.size);
+        }
+        if (scan_arena.names_used + length > scan_arena.names_size) {
+            scan_arena.names_size = scan_arena.names_size == 0 ? 4096 : scan_arena.names_size * 2;
+            scan_arena.names = scanGrow(scan_arena.names, scan_arena.names_size);
+        }
+        memcpy(scan_arena.names + scan_arena.names_used, path, length);
+        scan_arena.offsets[(*count)++] = scan_arena.names_used;
+        scan_arena.names_used += length;
+    }
+}
+
+/**
+ * Collects the paths of the files in student_data, in either layout, in to scan_arena, sorted by file name so the
+ * students they hold are listed in the same order on every run. A student found in both layouts is only
+ * collected from the sharded one, which is the newer copy while student_data is being migrated.
+ * @return The number of paths
+ */
+int scanDirectory() {
+    int count = 0;
+
+    // Pending saves are not in student_data until they are committed
+    commitSaves();
+
+    scan_count++;
+    last_scan_records = 0;
+    last_scan_allocations = 0;
+    scan_arena.names_used = 0;
+    walkStudentData(scanVisit, &count);
+    if (count > 0) {
+        qsort(scan_arena.offsets, count, sizeof(size_t), compareFileNames);
+
+        // Drop the flat copy of a student that is being migrated
+        int kept = 1;
+        for (int i = 1; i < count; i++) {
+            if (strcmp(baseName(scanName(i)), baseName(scanName(kept - 1))) != 0) {
+                scan_arena.offsets[kept++] = scan_arena.offsets[i];
+            }
+        }
+        count = kept;
+    }
+    last_scan_records = count;
+    scan_records += count;
+    return count;
+}
+
+/**
+ * Work shared by the threads loading student files. Each thread claims the next SCAN_BATCH files until none are
+ * left, so a slow file holds up only the thread reading it.
+ */
+struct ScanJob {
+    int dir_fd;
+    int count;
+    int next;
+#if !defined(_WIN32)
+    pthread_mutex_t lock;
+#endif
+};
+
+/**
+ * Loads files claimed from a scan job in to scan_arena until the job is done
+ * @param arg The scan job
+ * @return NULL
+ */
+void *scanWorker(void *arg) {
+    struct ScanJob *job = arg;
+    while (true) {
+#if !defined(_WIN32)
+        pthread_mutex_lock(&job->lock);
+#endif
+        int first = job->next;
+        job->next += SCAN_BATCH;
+#if !defined(_WIN32)
+        pthread_mutex_unlock(&job->lock);
+#endif
+        if (first >= job->count) {
+            return NULL;
+        }
+        int last = first + SCAN_BATCH < job->count ? first + SCAN_BATCH : job->count;
+        for (int i = first; i < last; i++) {
+            scan_arena.loaded[i] = readStudentFile(job->dir_fd, scanName(i), &scan_arena.students[i]);
+        }
+    }
+}
+
+/**
+ * Loads the files collected by scanDirectory() in to scan_arena.students, in batches through io_uring where the
+ * kernel has it and otherwise with up to SCAN_THREADS reads in flight. Small directories are read on the calling
+ * thread. scan_arena.loaded is false for each file that could not be read.
+ * @param count The number of files
+ */
+void loadStudents(int count) {
+#if defined(HAVE_IO_URING)
+    if (uringLoadStudents(count)) {
+        return;
+    }
+#endif
+    struct ScanJob job;
+    int started = 0;
+    job.count = count;
+    job.next = 0;
+#if defined(_WIN32)
+    job.dir_fd = -1;
+#else
+    job.dir_fd = open("student_data", O_RDONLY | O_DIRECTORY);
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_t threads[SCAN_THREADS];
+    while (count >= SCAN_MIN_FILES && started < SCAN_THREADS &&
+           startThread(&threads[started], scanWorker, &job) == 0) {
+        started++;
+    }
+#endif
+    // Whatever no thread was started for is loaded here
+    scanWorker(&job);
+#if !defined(_WIN32)
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&job.lock);
+    if (job.dir_fd != -1) {
+        close(job.dir_fd);
+    }
+#endif
+}
+
+/**
+ * Copies a string folded to lower case
+ * @param dst The buffer to copy in to
+ * @param src The string to fold
+ */
+void foldString(char *dst, const char *src) {
+    while (*src != '\0') {
+        *dst++ = tolower((unsigned char) *src++);
+    }
+    *dst = '\0';
+}
+
+/**
+ * Finds the cache map slot of a file name
+ * @param file_name The file name to look for
+ * @return The slot holding the file, or -1 if it is not cached
+ */
+int cacheFindSlot(const char *file_name) {
+    if (cache_map_size == 0) {
+        return -1;
+    }
+    unsigned int mask = cache_map_size - 1;
+    unsigned int pos = cacheHash(file_name) & mask;
+    while (cache_map[pos] != -1) {
+        if (cache_map[pos] >= 0 && strcmp(cache[cache_map[pos]].file_name, file_name) == 0) {
+            return pos;
+        }
+        pos = (pos + 1) & mask;
+    }
+    return -1;
+}
+
+/**
+ * Adds a cache index to the cache map, growing the map when it is 3/4 full
+ * @param index The index into cache
+ */
+void cacheMapInsert(int index) {
+    if ((cache_map_used + 1) * 4 > cache_map_size * 3) {
+        free(cache_map);
+        cache_map_size = cache_map_size == 0 ? 64 : cache_map_size * 2;
+        while (cache_map_size < cache_count * 2) {
+            cache_map_size *= 2;
+        }
+        cache_map = malloc(sizeof(int) * cache_map_size);
+        if (cache_map == NULL) {
+            printf("malloc() failed\n");
+            exit(-1);
+        }
+        for (int i = 0; i < cache_map_size; i++) {
+            cache_map[i] = -1;
+        }
+        cache_map_used = 0;
+
+        // Re-add every cached student other than the new one
+        for (int i = 0; i < cache_count; i++) {
+            if (i != index) {
+                cacheMapInsert(i);
+            }
+        }
+    }
+    unsigned int mask = cache_map_size - 1;
+    unsigned int pos = cacheHash(cache[index].file_name) & mask;
+    while (cache_map[pos] >= 0) {
+        pos = (pos + 1) & mask;
+    }
+    if (cache_map[pos] == -1) {
+        cache_map_used++;
+    }
+    cache_map[pos] = index;
+}
+
+/**
+ * Adds or replaces a student in the cache
+ * @param file_name The name of the student's file in student_data
+ * @param student The student data to cache
+ */
+void cachePut(const char *file_name, struct Student *student) {
+    if (!cache_enabled || strlen(file_name) > CACHE_NAME_MAX) {
+        return;
+    }
+
+    int slot = cacheFindSlot(file_name);
+    int index;
+    if (slot != -1) {
+        index = cache_map[slot];
+    } else {
+        if (cache_count == cache_size) {
+            cache_size = cache_size == 0 ? 64 : cache_size * 2;
+            cache = realloc(cache, sizeof(struct CachedStudent) * cache_size);
+            if (cache == NULL) {
+                printf("malloc() failed\n");
+                exit(-1);
+            }
+        }
+        index = cache_count++;
+        strcpy(cache[index].file_name, file_name);
+        cacheMapInsert(index);
+        if (index > 0 && strcmp(cache[index - 1].file_name, file_name) > 0) {
+            cache_ordered = false;
+        }
+    }
+
+    // Fold the search keys once so select compares them directly
+    cache[index].student = *student;
+    foldString(cache[index].usf_id_key, student->usf_id);
+    foldString(cache[index].name_key, student->name);
+    foldString(cache[index].email_key, student->email);
+}
+
+/**
+ * Removes a student from the cache. The last cached student takes its place.
+ * @param file_name The name of the student's file in student_data
+ */
+void cacheRemove(const char *file_name) {
+    int slot = cacheFindSlot(file_name);
+    if (slot == -1) {
+        return;
+    }
+    int index = cache_map[slot];
+    cache_map[slot] = -2;
+    cache_count--;
+
+    // Move the last student into the hole and point its map slot at the new index
+    if (index != cache_count) {
+        int moved = cacheFindSlot(cache[cache_count].file_name);
+        cache[index] = cache[cache_count];
+        cache_map[moved] = index;
+        cache_ordered = false;
+    }
+}
+
+/**
+ * Orders cached students for qsort() by file name
+ * @param a The first cached student
+ * @param b The second cached student
+ * @return Negative, zero or positive as a sorts before, with or after b
+ */
+int compareCachedStudents(const void *a, const void *b) {
+    return strcmp(((const struct CachedStudent *) a)->file_name, ((const struct CachedStudent *) b)->file_name);
+}
+
+/**
+ * Puts cache[] back in file name order after inserts and removals have moved students, and re-points the cache map
+ * at their new indexes. Listing in order then only sorts after the cache has changed.
+ */
+void cacheSort() {
+    if (cache_ordered) {
+        return;
+    }
+    qsort(cache, cache_count, sizeof(struct CachedStudent), compareCachedStudents);
+    cache_map_used = 0;
+    for (int i = 0; i < cache_map_size; i++) {
+        cache_map[i] = -1;
+    }
+    for (int i = 0; i < cache_count; i++) {
+        cacheMapInsert(i);
+    }
+    cache_ordered = true;
+}
+
+/**
+ * Loads a file from student_data into the cache, or drops it from the cache if it cannot be read
+ * @param path The path of the file relative to student_data
+ */
+void cacheLoad(const char *path) {
+    struct Student *student = loadStudentFile(path);
+    if (student != NULL) {
+        cachePut(baseName(path), student);
+        free(student);
+    } else {
+        cacheRemove(baseName(path));
+    }
+}
+
+/**
+ * Drops a removed file from the cache, unless the student is still in student_data in the other layout, as when a
+ * migration removes the flat copy of a student it has already moved
+ * @param path The path of the removed file relative to student_data
+ */
+void cacheForget(const char *path) {
+    const char *name = baseName(path);
+    size_t length = strlen(name);
+    char usf_id[10 + 1];
+    char other[STUDENT_PATH_MAX];
+    struct stat st = {0};
+    if (length > 4 && length - 4 <= 10 && strcmp(name + length - 4, ".txt") == 0) {
+        memcpy(usf_id, name, length - 4);
+        usf_id[length - 4] = '\0';
+        studentPath(usf_id, name == path, other);
+        if (stat(other, &st) == 0) {
+            cacheLoad(other + strlen("student_data/"));
+            return;
+        }
+    }
+    cacheRemove(name);
+}
+
+/**
+ * Empties the cache and loads every file in student_data in to it
+ */
+void cacheScan() {
+    cache_count = 0;
+    cache_ordered = true;
+    cache_map_used = 0;
+    for (int i = 0; i < cache_map_size; i++) {
+        cache_map[i] = -1;
+    }
+    int count = scanDirectory();
+    loadStudents(count);
+    for (int i = 0; i < count; i++) {
+        if (scan_arena.loaded[i]) {
+            cachePut(baseName(scanName(i)), &scan_arena.students[i]);
+        }
+    }
+}
+
+#if defined(__linux__)
+/**
+ * Starts watching a directory of student_data. A shard directory the cache cannot watch would go stale, so the
+ * cache is disabled instead.
+ * @param path The directory relative to student_data, "" for student_data itself
+ * @return The watch descriptor, or -1 if the directory could not be watched
+ */
+int cacheWatch(const char *path) {
+    char full_path[STUDENT_PATH_MAX];
+    snprintf(full_path, sizeof(full_path), "student_data/%s", path);
+    int wd = inotify_add_watch(cache_watch, full_path, IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE |
+                                                       IN_DELETE_SELF | IN_CREATE | IN_ONLYDIR);
+    if (wd == -1) {
+        cache_enabled = false;
+        return -1;
+    }
+    if (wd >= cache_watch_size) {
+        int size = cache_watch_size == 0 ? 64 : cache_watch_size;
+        while (size <= wd) {
+            size *= 2;
+        }
+        cache_watch_paths = realloc(cache_watch_paths, sizeof(*cache_watch_paths) * size);
+        if (cache_watch_paths == NULL) {
+            printf("malloc() failed\n");
+            exit(-1);
+        }
+        memset(cache_watch_paths + cache_watch_size, 0, sizeof(*cache_watch_paths) * (size - cache_watch_size));
+        cache_watch_size = size;
+    }
+    snprintf(cache_watch_paths[wd], sizeof(cache_watch_paths[wd]), "%s", path);
+    return wd;
+}
+
+/**
+ * Watches each shard directory found while walking student_data, and with a context also loads each student file
+ * @param path The path of a file or shard directory relative to student_data
+ * @param is_directory If it is a shard directory
+ * @param context Non-NULL to load files as well
+ */
+void cacheVisit(const char *path, bool is_directory, void *context) {
+    if (is_directory) {
+        cacheWatch(path);
+    } else if (context != NULL && baseName(path)[0] != '.') {
+        cacheLoad(path);
+    }
+}
+#endif
+
+/**
+ * Starts watching student_data and loads it in to the cache. Leaves the cache disabled if the directory cannot
+ * be watched.
+ */
+void cacheOpen() {
+#if defined(__linux__)
+    cache_watch = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (cache_watch == -1) {
+        return;
+    }
+    // Watch before scanning so no change between the two is missed
+    cache_enabled = true;
+    cache_root_watch = cacheWatch("");
+    walkStudentData(cacheVisit, NULL);
+    if (!cache_enabled) {
+        close(cache_watch);
+        cache_watch = -1;
+        return;
+    }
+    cacheScan();
+#endif
+}
+
+/**
+ * Applies changes made to student_data since the last refresh, re-reading only the files that changed
+ */
+void cacheRefresh() {
+#if defined(__linux__)
+    char buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    ssize_t length;
+
+    while ((length = read(cache_watch, buffer, sizeof(buffer))) > 0) {
+        for (char *ptr = buffer; ptr < buffer + length;) {
+            struct inotify_event *event = (struct inotify_event *) ptr;
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            // Build the path of the file relative to student_data
+            const char *directory = event->wd >= 0 && event->wd < cache_watch_size ? cache_watch_paths[event->wd] : "";
+            char path[STUDENT_PATH_MAX];
+            if (event->len > 0) {
+                snprintf(path, sizeof(path), "%s%s%s", directory, directory[0] != '\0' ? "/" : "", event->name);
+            }
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                // Events were lost, so watch any new shard directories and reload everything
+                walkStudentData(cacheVisit, NULL);
+                cacheScan();
+            } else if (event->mask & (IN_DELETE_SELF | IN_IGNORED)) {
+                if (event->wd == cache_root_watch) {
+                    // The directory itself went away, fall back to scanning
+                    cache_enabled = false;
+                }
+            } else if (event->len > 0 && (event->mask & IN_ISDIR)) {
+                // A new shard directory may already hold files, so load them once it is watched
+                if ((event->mask & (IN_CREATE | IN_MOVED_TO)) && strlen(directory) < 5 &&
+                    isShardName(event->name) && cacheWatch(path) != -1) {
+                    walkDirectory(path, directory[0] == '\0' ? 1 : 2, cacheVisit, path);
+                }
+            } else if (event->len > 0 && event->name[0] == '.') {
+                // Temporary files written by saveStudent() are not students
+            } else if (event->len > 0 && (event->mask & (IN_DELETE | IN_MOVED_FROM))) {
+                cacheForget(path);
+            } else if (event->len > 0 && (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))) {
+                cacheLoad(path);
+            }
+            if (!cache_enabled) {
+                close(cache_watch);
+                cache_watch = -1;
+                return;
+            }
+        }
+    }
+#endif
+}
+
+/**
+ * Frees the cache and stops watching student_data
+ */
+void cacheClose() {
+#if defined(__linux__)
+    if (cache_watch != -1) {
+        close(cache_watch);
+        cache_watch = -1;
+    }
+#endif
+    free(cache);
+    free(cache_map);
+    free(cache_watch_paths);
+    cache = NULL;
+    cache_map = NULL;
+    cache_watch_paths = NULL;
+    cache_watch_size = 0;
+    cache_count = cache_size = cache_map_size = cache_map_used = 0;
+    cache_enabled = false;
+}
+
+/**
+ * Builds the path of a log segment file
+ * @param number The segment number
+ * @return The path, which must be free()d
+ */
+char *logSegmentPath(int number) {
+    char file_name[32];
+    snprintf(file_name, sizeof(file_name), "student_log/%06d.seg", number);
+    return concat(file_name, "");
+}
+
+/**
+ * Finds the log map slot of a USF ID
+ * @param usf_id The USF ID to look for
+ * @return The slot holding the student, or -1 if the log has no such student
+ */
+int logFindSlot(const char *usf_id) {
+    if (log_map_size == 0) {
+        return -1;
+    }
+    unsigned int mask = log_map_size - 1;
+    unsigned int pos = cacheHash(usf_id) & mask;
+    while (log_map[pos] != -1) {
+        if (log_map[pos] >= 0 && strcmp(log_entries[log_map[pos]].usf_id, usf_id) == 0) {
+            return pos;
+        }
+        pos = (pos + 1) & mask;
+    }
+    return -1;
+}
+
+/**
+ * Adds a log entry index to the log map, growing the map when it is 3/4 full
+ * @param index The index into log_entries
+ */
+void logMapInsert(int index) {
+    if ((log_map_used + 1) * 4 > log_map_size * 3) {
+        free(log_map);
+        log_map_size = log_map_size == 0 ? 64 : log_map_size * 2;
+        while (log_map_size < log_entry_count * 2) {
+            log_map_size *= 2;
+        }
+        log_map = malloc(sizeof(int) * log_map_size);
+        if (log_map == NULL) {
+            printf("malloc() failed\n");
+            exit(-1);
+        }
+        for (int i = 0; i < log_map_size; i++) {
+            log_map[i] = -1;
+        }
+        log_map_used = 0;
+
+        // Re-add every entry other than the new one
+        for (int i = 0; i < log_entry_count; i++) {
+            if (i != index) {
+                logMapInsert(i);
+            }
+        }
+    }
+    unsigned int mask = log_map_size - 1;
+    unsigned int pos = cacheHash(log_entries[index].usf_id) & mask;
+    while (log_map[pos] >= 0) {
+        pos = (pos + 1) & mask;
+    }
+    if (log_map[pos] == -1) {
+        log_map_used++;
+    }
+    log_map[pos] = index;
+}
+
+/**
+ * Points the offset index at the newest version of a student
+ * @param usf_id The USF ID of the student
+ * @param segment The index into log_segments of the segment holding the record
+ * @param offset The offset of the record within the segment
+ */
+void logIndexPut(const char *usf_id, int segment, long offset) {
+    int slot = logFindSlot(usf_id);
+    int index;
+    if (slot != -1) {
+        index = log_map[slot];
+        log_segments[log_entries[index].segment].live--;
+    } else {
+        if (log_entry_count == log_entry_size) {
+            log_entry_size = log_entry_size == 0 ? 64 : log_entry_size * 2;
+            log_entries = realloc(log_entries, sizeof(struct LogEntry) * log_entry_size);
+            if (log_entries == NULL) {
+                printf("malloc() failed\n");
+                exit(-1);
+            }
+        }
+        index = log_entry_count++;
+        strcpy(log_entries[index].usf_id, usf_id);
+        logMapInsert(index);
+    }
+    log_entries[index].segment = segment;
+    log_entries[index].offset = offset;
+    log_segments[segment].live++;
+}
+
+/**
+ * Drops a student from the offset index. The last entry takes its place.
+ * @param usf_id The USF ID of the student
+ * @return If the student was in the index
+ */
+bool logIndexRemove(const char *usf_id) {
+    int slot = logFindSlot(usf_id);
+    if (slot == -1) {
+        return false;
+    }
+    int index = log_map[slot];
+    log_segments[log_entries[index].segment].live--;
+    log_map[slot] = -2;
+    log_entry_count--;
+
+    // Move the last entry into the hole and point its map slot at the new index
+    if (index != log_entry_count) {
+        int moved = logFindSlot(log_entries[log_entry_count].usf_id);
+        log_entries[index] = log_entries[log_entry_count];
+        log_map[moved] = index;
+    }
+    return true;
+}
+
+/**
+ * Packs the three grades of a student in to one word, GRADE_BITS each. A grade that does not fit is stored as the
+ * largest value that does.
+ * @param student The student
+ * @return The packed grades
+ */
+unsigned short packGrades(const struct Student *student) {
+    int grades[3] = {student->presentation_grade, student->essay_grade, student->term_project_grade};
+    int limit = (1 << GRADE_BITS) - 1;
+    unsigned short packed = 0;
+    for (int i = 0; i < 3; i++) {
+        int grade = grades[i] < 0 ? 0 : grades[i] > limit ? limit : grades[i];
+        packed |= (unsigned short) (grade << (i * GRADE_BITS));
+    }
+    return packed;
+}
+
+/**
+ * Unpacks the grades packed by packGrades() in to a student
+ * @param packed The packed grades
+ * @param student The student to fill in
+ */
+void unpackGrades(unsigned short packed, struct Student *student) {
+    int mask = (1 << GRADE_BITS) - 1;
+    student->presentation_grade = packed & mask;
+    student->essay_grade = (packed >> GRADE_BITS) & mask;
+    student->term_project_grade = (packed >> (2 * GRADE_BITS)) & mask;
+}
+
+/**
+ * Gets where a record of a segment starts
+ * @param segment The segment
+ * @param index The number of records before it in the segment
+ * @return The offset of the record
+ */
+long logRecordOffset(const struct LogSegment *segment, long index) {
+    if (segment->version == 1) {
+        return index * (long) sizeof(struct LogRecordV1);
+    }
+    return (long) strlen(LOG_MAGIC) + index * (long) sizeof(struct LogRecord);
+}
+
+/**
+ * Reads the record at the current position of a segment, in whichever format the segment uses
+ * @param segment The segment
+ * @param op Set to the operation of the record
+ * @param student Set to the student the record is for
+ * @return If a whole record was read
+ */
+bool logReadRecord(struct LogSegment *segment, char *op, struct Student *student) {
+    if (segment->version == 1) {
+        struct LogRecordV1 old;
+        if (fread(&old, sizeof(old), 1, segment->fp) != 1) {
+            return false;
+        }
+        *op = old.op;
+        *student = old.student;
+    } else {
+        struct LogRecord record;
+        if (fread(&record, sizeof(record), 1, segment->fp) != 1) {
+            return false;
+        }
+        *op = record.op;
+        memcpy(student->usf_id, record.usf_id, sizeof(student->usf_id));
+        memcpy(student->name, record.name, sizeof(student->name));
+        memcpy(student->email, record.email, sizeof(student->email));
+        unpackGrades((unsigned short) (record.grades[0] | record.grades[1] << 8), student);
+    }
+    student->usf_id[10] = '\0';
+    student->name[40] = '\0';
+    student->email[40] = '\0';
+    return true;
+}
+
+/**
+ * Adds a segment to log_segments and opens it for reading
+ * @param number The segment number
+ * @return The index of the segment in log_segments
+ */
+int logAddSegment(int number) {
+    if (log_segment_count == log_segment_size) {
+        log_segment_size = log_segment_size == 0 ? 16 : log_segment_size * 2;
+        log_segments = realloc(log_segments, sizeof(struct LogSegment) * log_segment_size);
+        if (log_segments == NULL) {
+            printf("malloc() failed\n");
+            exit(-1);
+        }
+    }
+    char *path = logSegmentPath(number);
+    struct LogSegment *segment = &log_segments[log_segment_count];
+    segment->number = number;
+    segment->fp = fopen(path, "rb");
+    segment->records = 0;
+    segment->live = 0;
+    segment->version = 2;
+    free(path);
+
+    // A segment without the header holds version 1 records, as does an empty file that never got one
+    char magic[sizeof(LOG_MAGIC) - 1];
+    if (segment->fp != NULL && (fread(magic, sizeof(magic), 1, segment->fp) != 1 ||
+                                memcmp(magic, LOG_MAGIC, sizeof(magic)) != 0)) {
+        segment->version = 1;
+        fseek(segment->fp, 0, SEEK_SET);
+    }
+    return log_segment_count++;
+}
+
+/**
+ * Seals the active segment and starts appending to a new one
+ */
+void logStartSegment() {
+    int number = log_segment_count == 0 ? 1 : log_segments[log_segment_count - 1].number + 1;
+    char *path = logSegmentPath(number);
+
+    lockSaves();
+    if (log_active != NULL) {
+        if (fsync_policy != FSYNC_NONE) {
+            syncFile(log_active);
+        }
+        fclose(log_active);
+    }
+    log_active = fopen(path, "ab");
+    log_dirty = false;
+    bool written = log_active != NULL && fwrite(LOG_MAGIC, strlen(LOG_MAGIC), 1, log_active) == 1
+            && fflush(log_active) == 0;
+    unlockSaves();
+    if (log_active == NULL) {
+        printf("Error opening file!\n");
+        exit(1);
+    }
+    // Without its magic the segment would be read back as version 1, so a short write is fatal
+    if (!written) {
+        fclose(log_active);
+        remove(path);
+        printf("Error writing file!\n");
+        exit(1);
+    }
+    free(path);
+    if (fsync_policy != FSYNC_NONE) {
+        syncDirectory("student_log");
+    }
+    logAddSegment(number);
+}
+
+/**
+ * Appends a record to the active segment, starting a new segment once the active one is full
+ * @param op 'P' to store the student or 'D' to delete it
+ * @param student The student the record is for
+ * @return The offset of the record within the active segment, the last entry of log_segments
+ */
+long logAppend(char op, struct Student *student) {
+    struct LogSegment *segment = &log_segments[log_segment_count - 1];
+    if (logRecordOffset(segment, segment->records + 1) > LOG_SEGMENT_BYTES) {
+        logStartSegment();
+        segment = &log_segments[log_segment_count - 1];
+    }
+
+    struct LogRecord record;
+    memset(&record, 0, sizeof(record));
+    record.op = op;
+    strcpy(record.usf_id, student->usf_id);
+    strcpy(record.name, student->name);
+    strcpy(record.email, student->email);
+    unsigned short grades = packGrades(student);
+    record.grades[0] = grades & 0xff;
+    record.grades[1] = grades >> 8;
+    lockSaves();
+    if (fwrite(&record, sizeof(record), 1, log_active) != 1 || fflush(log_active) != 0) {
+        printf("Error writing file!\n");
+        exit(1);
+    }
+    if (fsync_policy == FSYNC_OP) {
+        syncFile(log_active);
+    } else if (fsync_policy == FSYNC_GROUP) {
+        log_dirty = true;
+    }
+    unlockSaves();
+    return logRecordOffset(segment, segment->records++);
+}
+
+/**
+ * Reads the student an offset index entry points at. This method uses malloc() so the returned value must be free()
+ * @param index The index into log_entries
+ * @return The student, or NULL if the record cannot be read
+ */
+struct Student *logReadEntry(int index) {
+    struct LogSegment *segment = &log_segments[log_entries[index].segment];
+    struct Student record;
+    char op;
+    if (segment->fp == NULL || fseek(segment->fp, log_entries[index].offset, SEEK_SET) != 0 ||
+        !logReadRecord(segment, &op, &record)) {
+        return NULL;
+    }
+    struct Student *student = malloc(sizeof(struct Student));
+    *student = record;
+    return student;
+}
+
+/**
+ * Reads a student from the log. This method uses malloc() so the returned value must be free()
+ * @param usf_id The USF ID of the student
+ * @return The student, or NULL if the log has no such student
+ */
+struct Student *logRead(const char *usf_id) {
+    int slot = logFindSlot(usf_id);
+    return slot == -1 ? NULL : logReadEntry(log_map[slot]);
+}
+
+/**
+ * Stores a student in the log
+ * @param student The student to store
+ */
+void logPut(struct Student *student) {
+    long offset = logAppend('P', student);
+    logIndexPut(student->usf_id, log_segment_count - 1, offset);
+}
+
+/**
+ * Deletes a student from the log by appending a tombstone
+ * @param usf_id The USF ID of the student
+ * @return If the student was in the log
+ */
+bool logDelete(const char *usf_id) {
+    if (logFindSlot(usf_id) == -1) {
+        return false;
+    }
+    struct Student tombstone;
+    memset(&tombstone, 0, sizeof(tombstone));
+    strcpy(tombstone.usf_id, usf_id);
+    logAppend('D', &tombstone);
+    return logIndexRemove(usf_id);
+}
+
+/**
+ * Orders segment numbers for qsort()
+ */
+int compareSegmentNumbers(const void *a, const void *b) {
+    return *(const int *) a - *(const int *) b;
+}
+
+/**
+ * Opens student_log, replaying every segment oldest first to rebuild the offset index. A record cut short by a
+ * crash at the end of a segment is ignored. New records always go to a fresh segment.
+ */
+void logOpen() {
+    DIR *dir;
+    struct dirent *ent;
+    int *numbers = NULL;
+    int number_count = 0;
+    int number_size = 0;
+
+    makeDirectory("student_log");
+    if ((dir = opendir("student_log")) != NULL) {
+        while ((ent = readdir(dir)) != NULL) {
+            int number;
+            char extension[5];
+            if (ent->d_type == DT_REG && sscanf(ent->d_name, "%d.%4s", &number, extension) == 2 &&
+                strcmp(extension, "seg") == 0) {
+                if (number_count == number_size) {
+                    number_size = number_size == 0 ? 16 : number_size * 2;
+                    numbers = realloc(numbers, sizeof(int) * number_size);
+                }
+                numbers[number_count++] = number;
+            }
+        }
+        closedir(dir);
+    }
+    qsort(numbers, number_count, sizeof(int), compareSegmentNumbers);
+
+    struct Student student;
+    char op;
+    for (int i = 0; i < number_count; i++) {
+        int segment = logAddSegment(numbers[i]);
+        if (log_segments[segment].fp == NULL) {
+            continue;
+        }
+        while (logReadRecord(&log_segments[segment], &op, &student)) {
+            if (op == 'P') {
+                logIndexPut(student.usf_id, segment, logRecordOffset(&log_segments[segment],
+                                                                     log_segments[segment].records));
+            } else if (op == 'D') {
+                logIndexRemove(student.usf_id);
+            }
+            log_segments[segment].records++;
+        }
+    }
+    free(numbers);
+
+    logStartSegment();
+    log_enabled = true;
+}
+
+/**
+ * Compacts one sealed segment that is mostly obsolete, or small enough to fold in to the active segment. The
+ * records still in use are appended to the active segment and the old segment file is removed. Called between
+ * commands so each call does a bounded amount of work.
+ */
+void logCompact() {
+    if (!log_enabled) {
+        return;
+    }
+
+    // Find a sealed segment worth compacting
+    int target = -1;
+    bool older = false; // Whether a segment older than the target still exists
+    for (int i = 0; i < log_segment_count - 1; i++) {
+        struct LogSegment *segment = &log_segments[i];
+        if (segment->fp == NULL) {
+            continue;
+        }
+        if (segment->live * 2 < segment->records || segment->version == 1 ||
+            logRecordOffset(segment, segment->records) < LOG_SEGMENT_BYTES / 4) {
+            target = i;
+            break;
+        }
+        older = true;
+    }
+    if (target == -1) {
+        return;
+    }
+
+    struct LogSegment *segment = &log_segments[target];
+    struct Student student;
+    char op;
+    fseek(segment->fp, logRecordOffset(segment, 0), SEEK_SET);
+    for (long i = 0; i < segment->records && logReadRecord(segment, &op, &student); i++) {
+        int slot = logFindSlot(student.usf_id);
+        long offset = logRecordOffset(segment, i);
+        if (op == 'P') {
+            // Keep the record only if it is still the newest version of the student
+            if (slot != -1 && log_entries[log_map[slot]].segment == target &&
+                log_entries[log_map[slot]].offset == offset) {
+                logPut(&student);
+            }
+        } else if (op == 'D' && slot == -1 && older) {
+            // An older segment may still hold the deleted student, so carry the tombstone forward
+            logAppend('D', &student);
+        }
+        segment = &log_segments[target]; // logAppend() may have grown log_segments
+    }
+
+    fclose(segment->fp);
+    segment->fp = NULL;
+    segment->records = 0;
+    segment->live = 0;
+    char *path = logSegmentPath(segment->number);
+    remove(path);
+    free(path);
+}
+
+/**
+ * Closes every segment and frees the offset index
+ */
+void logClose() {
+    for (int i = 0; i < log_segment_count; i++) {
+        if (log_segments[i].fp != NULL) {
+            fclose(log_segments[i].fp);
+        }
+    }
+    if (log_active != NULL) {
+        fclose(log_active);
+    }
+    free(log_segments);
+    free(log_entries);
+    free(log_map);
+    log_segments = NULL;
+    log_entries = NULL;
+    log_map = NULL;
+    log_active = NULL;
+    log_segment_count = log_segment_size = log_entry_count = log_entry_size = log_map_size = log_map_used = 0;
+    log_enabled = false;
+}
+
+/**
+ * Reads a student from whichever storage backend is in use. This method uses malloc() so the returned value must
+ * be free()
+ * @param usf_id The USF ID of the student
+ * @return The student, or NULL if there is no such student
+ */
+struct Student *readStudent(const char *usf_id) {
+    if (log_enabled) {
+        return logRead(usf_id);
+    }
+    struct Student *student = NULL;
+    struct Student pending_student;
+    if (findPendingSave(usf_id, &pending_student)) {
+        student = malloc(sizeof(struct Student));
+        *student = pending_student;
+        return student;
+    }
+    // Look in the sharded layout first, as scanDirectory() does, so a half migrated student_data reads the same
+    char path[STUDENT_PATH_MAX];
+    struct stat st = {0};
+    for (int sharded = 1; sharded >= 0 && student == NULL; sharded--) {
+        studentPath(usf_id, sharded, path);
+        if (stat(path, &st) == 0) {
+            student = loadStudentFile(path + strlen("student_data/"));
+        }
+    }
+    return student;
+}
+
+/**
+ * Builds the path of the index bucket file that holds a key. Each bucket is a text file of "<key>\t<usf id>" lines.
+ * @param kind The index, either "name" or "email"
+ * @param key The folded key
+ * @return The path, which must be free()d
+ */
+char *indexBucketPath(const char *kind, const char *key) {
+    char bucket[16];
+    snprintf(bucket, sizeof(bucket), "/%03x.idx", cacheHash(key) & (INDEX_BUCKETS - 1));
+    char *partial_path = concat("student_index/", kind);
+    char *path = concat(partial_path, bucket);
+    free(partial_path);
+    return path;
+}
+
+/**
+ * Adds a key to an index
+ * @param kind The index, either "name" or "email"
+ * @param value The name or email, folded before it is stored
+ * @param usf_id The USF ID of the student the key belongs to
+ */
+void indexAdd(const char *kind, const char *value, const char *usf_id) {
+    char key[40 + 1];
+    foldString(key, value);
+    char *path = indexBucketPath(kind, key);
+    FILE *fp = fopen(path, "a");
+    free(path);
+    if (fp == NULL) {
+        return;
+    }
+    fprintf(fp, "%s\t%s\n", key, usf_id);
+    fclose(fp);
+}
+
+/**
+ * Removes a key from an index by rewriting its bucket without the matching line
+ * @param kind The index, either "name" or "email"
+ * @param value The name or email the key was added under
+ * @param usf_id The USF ID of the student the key belongs to
+ */
+void indexRemove(const char *kind, const char *value, const char *usf_id) {
+    char key[40 + 1];
+    foldString(key, value);
+    char *path = indexBucketPath(kind, key);
+    char *tmp_path = concat(path, ".tmp");
+    FILE *in = fopen(path, "r");
+    FILE *out = in != NULL ? fopen(tmp_path, "w") : NULL;
+
+    if (out != NULL) {
+        char line[40 + 1 + 10 + 2];
+        char entry[40 + 1 + 10 + 1];
+        snprintf(entry, sizeof(entry), "%s\t%s", key, usf_id);
+        while (read_line(in, line, sizeof(line) - 1) > 0) {
+            if (line[0] != '\0' && strcmp(line, entry) != 0) {
+                fprintf(out, "%s\n", line);
+            }
+        }
+        fclose(out);
+        fclose(in);
+        rename(tmp_path, path);
+    } else if (in != NULL) {
+        fclose(in);
+    }
+    free(tmp_path);
+    free(path);
+}
+
+/**
+ * Finds a student through an index. Each candidate is re-read from its file and checked, so a stale entry is
+ * skipped rather than returned.
+ * @param kind The index, either "name" or "email"
+ * @param key The folded name or email to find
+ * @return The student, which must be free()d, or NULL if the index has no matching student
+ */
+struct Student *indexFind(const char *kind, const char *key) {
+    char *path = indexBucketPath(kind, key);
+    FILE *fp = fopen(path, "r");
+    free(path);
+    if (fp == NULL) {
+        return NULL;
+    }
+
+    struct Student *student = NULL;
+    char line[40 + 1 + 10 + 2];
+    char student_key[40 + 1];
+    while (student == NULL && read_line(fp, line, sizeof(line) - 1) > 0) {
+        char *tab = strchr(line, '\t');
+        if (tab == NULL) {
+            continue;
+        }
+        *tab = '\0';
+        if (strcmp(line, key) != 0) {
+            continue;
+        }
+        if ((student = readStudent(tab + 1)) != NULL) {
+            foldString(student_key, strcmp(kind, "name") == 0 ? student->name : student->email);
+            if (strcmp(student_key, key) != 0) {
+                free(student);
+                student = NULL;
+            }
+        }
+    }
+    fclose(fp);
+    return student;
+}
+
+/**
+ * Rebuilds the name and email indexes from every stored student
+ */
+void indexRebuild() {
+    DIR *dir;
+    struct dirent *ent;
+    char *path;
+
+    makeDirectory("student_index");
+    makeDirectory("student_index/name");
+    makeDirectory("student_index/email");
+
+    // Empty the buckets before adding every student back
+    const char *kinds[] = {"student_index/name", "student_index/email"};
+    for (int k = 0; k < 2; k++) {
+        if ((dir = opendir(kinds[k])) != NULL) {
+            while ((ent = readdir(dir)) != NULL) {
+                if (ent->d_type == DT_REG) {
+                    char *partial_path = concat(kinds[k], "/");
+                    path = concat(partial_path, ent->d_name);
+                    free(partial_path);
+                    remove(path);
+                    free(path);
+                }
+            }
+            closedir(dir);
+        }
+    }
+
+    if (log_enabled) {
+        for (int i = 0; i < log_entry_count; i++) {
+            struct Student *student = logReadEntry(i);
+            if (student != NULL) {
+                indexAdd("name", student->name, student->usf_id);
+                indexAdd("email", student->email, student->usf_id);
+                free(student);
+            }
+        }
+    } else {
+        int count = scanDirectory();
+        loadStudents(count);
+        for (int i = 0; i < count; i++) {
+            if (scan_arena.loaded[i]) {
+                indexAdd("name", scan_arena.students[i].name, scan_arena.students[i].usf_id);
+                indexAdd("email", scan_arena.students[i].email, scan_arena.students[i].usf_id);
+            }
+        }
+    }
+}
+
+/**
+ * Selects a student by USF ID, name, or email. A USF ID is read directly from the storage backend and a name or
+ * email is found through its index, so neither scans student_data.
+ * @param needle The USF ID, name, or email to search for
+ * @return The student, which must be free()d, or NULL if no student matches
+ */
+struct Student *findStudent(const char *needle) {
+    struct Student *student = NULL;
+    char needle_key[128 + 1];
+    char id[10 + 1];
+    int slot;
+
+    cacheRefresh();
+
+    // Try the needle as a USF ID first, as typed and then in upper case
+    if (strlen(needle) <= 10) {
+        for (int attempt = 0; attempt < 2 && student == NULL; attempt++) {
+            for (int i = 0; i <= 10; i++) {
+                id[i] = attempt == 0 ? needle[i] : toupper((unsigned char) needle[i]);
+                if (needle[i] == '\0') {
+                    break;
+                }
+            }
+            char *file_name = concat(id, ".txt");
+            if (cache_enabled) {
+                if ((slot = cacheFindSlot(file_name)) != -1) {
+                    student = malloc(sizeof(struct Student));
+                    *student = cache[cache_map[slot]].student;
+                }
+            } else {
+                student = readStudent(id);
+            }
+            free(file_name);
+        }
+    }
+    if (student != NULL) {
+        return student;
+    }
+
+    foldString(needle_key, needle);
+    if (strlen(needle_key) <= 40) {
+        if ((student = indexFind("name", needle_key)) == NULL) {
+            student = indexFind("email", needle_key);
+        }
+    }
+
+    // A file copied in to student_data by hand is not indexed yet, so look for it in the cache
+    if (student == NULL && cache_enabled) {
+        for (int i = 0; i < cache_count; i++) {
+            if (strcmp(cache[i].usf_id_key, needle_key) == 0 || strcmp(cache[i].name_key, needle_key) == 0 ||
+                strcmp(cache[i].email_key, needle_key) == 0) {
+                student = malloc(sizeof(struct Student));
+                *student = cache[i].student;
+                break;
+            }
+        }
+    }
+    return student;
+}
+
+/** WORKING?
+ * Saves a student to a text file. The file and directory are automatically created if they do not already exist.
+ * With the log backend the student is appended to the active log segment instead.
+ * @param student The student data to save
+ * @return If the operation was a success
+ */
+bool saveStudent(struct Student *student) {
+
+    // Read the record being replaced so its index entries can be moved
+    struct Student *old_student = readStudent(student->usf_id);
+
+    if (log_enabled) {
+        // Append the new version to the log
+        logPut(student);
+    } else {
+        struct stat st = {0};
+
+        // Create the student_data directory if it does not already exist
+        if (stat("student_data", &st) == -1) {      //ADDED ALL CODE OTHER THAN 'if' AND 'mkdir'
+            #if defined(_WIN32)
+                mkdir("student_data");
+            #else
+                mkdir("student_data", 0700);
+            #endif
+        }
+
+        // Write to a temporary file next to the student file first so a crash never leaves a truncated student
+        // file behind
+        struct PendingSave save;
+        char directory[STUDENT_PATH_MAX];
+        studentPath(student->usf_id, shard_layout, save.path);
+        parentDirectory(save.path, directory);
+        if (snprintf(save.tmp_path, sizeof(save.tmp_path), "%s/.%s.%lu.tmp", directory, student->usf_id,
+                     save_sequence++) >= (int) sizeof(save.tmp_path)) {
+            printf("Error saving file!\n");
+            free(old_student);
+            return false;
+        }
+        if (shard_layout) {
+            makeShardDirectories(save.path);
+        }
+        save.student = *student;
+
+        // A copy in the other layout would hide or shadow this one, so it goes once the save is in place
+        studentPath(student->usf_id, !shard_layout, save.stale_path);
+        if (stat(save.stale_path, &st) == -1) {
+            save.stale_path[0] = '\0';
+        }
+
+        if (fsync_policy == FSYNC_GROUP || batch_saves) {
+            // Leave the save for the next group commit to write
+            save.length = snprintf(save.data, sizeof(save.data),
+                                   "%s\n%s\n%s\n%d\n%d\n%d\n",
+                                   student->usf_id,
+                                   student->name,
+                                   student->email,
+                                   student->presentation_grade,
+                                   student->essay_grade,
+                                   student->term_project_grade
+            );
+            if (pending_count == SAVE_MAX_PENDING) {
+                commitSaves();
+            }
+            lockSaves();
+            pending_saves[pending_count++] = save;
+            unlockSaves();
+        } else {
+            // Open the text file for writing
+            FILE *fp = fopen(save.tmp_path, "w");
+
+            if (fp == NULL) {
+                printf("Error opening file!\n");
+                free(old_student);
+                return false;
+            }
+
+            // Write to the text file
+            save.ok = fprintf(fp,
+                    "%s\n%s\n%s\n%d\n%d\n%d\n",
+                    student->usf_id,
+                    student->name,
+                    student->email,
+                    student->presentation_grade,
+                    student->essay_grade,
+                    student->term_project_grade
+            ) >= 0;
+
+            if (fsync_policy == FSYNC_OP && !syncFile(fp)) {
+                save.ok = false;
+            }
+            // Close the text file and put it in place, unless it was not fully written
+            if (fclose(fp) != 0) {
+                save.ok = false;
+            }
+            if (!finishSave(&save)) {
+                free(old_student);
+                return false;
+            }
+            if (fsync_policy == FSYNC_OP) {
+                syncDirectory(directory);
+                if (save.stale_path[0] != '\0') {
+                    parentDirectory(save.stale_path, directory);
+                    syncDirectory(directory);
+                }
+            }
+        }
+    }
+
+    // Keep the name and email indexes current, touching only the buckets whose key changed
+    makeDirectory("student_index");
+    makeDirectory("student_index/name");
+    makeDirectory("student_index/email");
+    if (old_student == NULL || strcasecmp(old_student->name, student->name) != 0) {
+        if (old_student != NULL) {
+            indexRemove("name", old_student->name, student->usf_id);
+        }
+        indexAdd("name", student->name, student->usf_id);
+    }
+    if (old_student == NULL || strcasecmp(old_student->email, student->email) != 0) {
+        if (old_student != NULL) {
+            indexRemove("email", old_student->email, student->usf_id);
+        }
+        indexAdd("email", student->email, student->usf_id);
+    }
+    free(old_student);
+
+    // Keep the cache current without waiting for the inotify event
+    char *file_name = concat(student->usf_id, ".txt");
+    cachePut(file_name, student);
+    free(file_name);
+
+    return true;
+}
+
+/**
+ * Deletes the file or log record associated with the student. This method does not free() the *student parameter.
+ * @param student The student with the file to delete
+ * @return If the delete operation was successful
+ */
+bool deleteStudent(struct Student *student) {
+    bool result = false;
+
+    // Read the record being deleted so its index entries are removed with it
+    struct Student *old_student = readStudent(student->usf_id);
+
+    if (log_enabled) {
+        // Append a tombstone to the log
+        result = logDelete(student->usf_id);
+    } else {
+        char path[STUDENT_PATH_MAX];
+        char directory[STUDENT_PATH_MAX];
+
+        // Commit pending saves first so none of them brings the student back
+        commitSaves();
+
+        // Delete the file from both layouts, as a migration may have left a copy in each
+        for (int sharded = 0; sharded < 2; sharded++) {
+            studentPath(student->usf_id, sharded, path);
+            if (remove(path) == 0) {
+                result = true;
+                cacheRemove(baseName(path));
+                if (fsync_policy != FSYNC_NONE) {
+                    parentDirectory(path, directory);
+                    syncDirectory(directory);
+                }
+            }
+        }
+    }
+
+    if (result && old_student != NULL) {
+        indexRemove("name", old_student->name, old_student->usf_id);
+        indexRemove("email", old_student->email, old_student->usf_id);
+    }
+
+    // De-allocate resources
+    free(old_student);
+    return result;
+}
+
+/**
+ * Moves every student file in the flat layout to the sharded layout. Readers look in both layouts and a student
+ * found in both is read from the sharded one, so students stay readable throughout and an interrupted migration
+ * can be run again to finish it.
+ */
+void migrateStudents() {
+    char path[STUDENT_PATH_MAX];
+    char directory[STUDENT_PATH_MAX];
+    char usf_id[10 + 1];
+    struct stat st = {0};
+    int moved = 0;
+    int count = 0;
+
+    // Saves go to the sharded layout from here on, so none lands behind the migration
+    useShardLayout();
+    commitSaves();
+
+    // Collect the flat files before moving any, as readdir() may skip entries of a directory that changes under it
+    scan_arena.names_used = 0;
+    walkDirectory("", 2, scanVisit, &count);
+    for (int i = 0; i < count; i++) {
+        const char *name = scanName(i);
+        size_t length = strlen(name);
+        if (length <= 4 || length - 4 > 10 || strcmp(name + length - 4, ".txt") != 0) {
+            printf("Skipped %s, which is not named after a USF ID.\n", name);
+            continue;
+        }
+        memcpy(usf_id, name, length - 4);
+        usf_id[length - 4] = '\0';
+        studentPath(usf_id, true, path);
+        makeShardDirectories(path);
+
+        // A sharded copy was saved after the migration started, so the flat one is out of date
+        char *flat_path = concat("student_data/", name);
+        if (stat(path, &st) == 0) {
+            remove(flat_path);
+        } else if (rename(flat_path, path) != 0) {
+            printf("Error moving %s, errno = %d\n", flat_path, errno);
+            free(flat_path);
+            continue;
+        }
+        free(flat_path);
+        if (fsync_policy != FSYNC_NONE) {
+            parentDirectory(path, directory);
+            syncDirectory(directory);
+        }
+        if (++moved % 1000 == 0) {
+            printf("Migrated %d of %d students...\n", moved, count);
+        }
+    }
+    if (fsync_policy != FSYNC_NONE) {
+        syncDirectory("student_data");
+    }
+    printf("Migrated %d students to the sharded layout.\n", moved);
+}
+
+/**
+ * Converts a letter grade of the students.txt roster to the 0-4 grade of a student file, accepting 0-4 as well
+ * @param letter The letter, A, B, C, D, or F in either case
+ * @return The grade, 4 for A down to 0 for F, or -1 if the letter is not a grade
+ */
+int gradeFromLetter(char letter) {
+    switch (toupper((unsigned char) letter)) {
+        case 'A': case '4':
+            return 4;
+        case 'B': case '3':
+            return 3;
+        case 'C': case '2':
+            return 2;
+        case 'D': case '1':
+            return 1;
+        case 'F': case '0':
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+/**
+ * Converts a 0-4 grade of a student file to the letter grade of the students.txt roster
+ * @param grade The grade
+ * @return The letter, or '?' if the grade is out of range
+ */
+char letterFromGrade(int grade) {
+    return grade >= 0 && grade <= 4 ? "FDCBA"[grade] : '?';
+}
+
+/**
+ * Converts a main.c UID to the 10 character USF ID of a student file. main.c accepts 1 to 10 digits, so shorter
+ * all-digit IDs are padded with leading zeros.
+ * @param uid The ID from the roster
+ * @param usf_id Set to the USF ID
+ * @return 1 if the ID was copied, 2 if it was padded, or 0 if it cannot be a USF ID
+ */
+int usfIdFromUid(const char *uid, char *usf_id) {
+    size_t length = strlen(uid);
+    if (length == 10) {
+        strcpy(usf_id, uid);
+        return 1;
+    }
+    if (length == 0 || length > 10) {
+        return 0;
+    }
+    for (size_t i = 0; i < length; i++) {
+        if (!isdigit((unsigned char) uid[i])) {
+            return 0;
+        }
+    }
+    memset(usf_id, '0', 10 - length);
+    strcpy(usf_id + 10 - length, uid);
+    return 2;
+}
+
+/**
+ * Progress of an import
+ */
+struct ImportJob {
+    int imported;
+    int skipped;
+    int padded;
+};
+
+/**
+ * Saves a student read from a roster, after checking it fits a student file
+ * @param job The import
+ * @param student The student, whose usf_id is the ID from the roster
+ * @return If the student was saved
+ */
+bool importStudent(struct ImportJob *job, struct Student *student) {
+    char usf_id[10 + 1];
+    int converted = usfIdFromUid(student->usf_id, usf_id);
+    if (converted == 0 || strlen(student->name) > 40 || strlen(student->email) > 40 ||
+        student->presentation_grade < 0 || student->essay_grade < 0 || student->term_project_grade < 0) {
+        printf("Skipped student %s (%s), who does not fit a student file.\n", student->usf_id, student->name);
+        job->skipped++;
+        return false;
+    }
+    strcpy(student->usf_id, usf_id);
+    if (!saveStudent(student)) {
+        job->skipped++;
+        return false;
+    }
+    if (converted == 2) {
+        job->padded++;
+    }
+    if (++job->imported % 1000 == 0) {
+        printf("Imported %d students...\n", job->imported);
+    }
+    return true;
+}
+
+/**
+ * Reads a students.txt roster, six non-blank lines per student: name, email, USF ID, and presentation, essay, and
+ * term project letter grades. The roster is read one student at a time, so memory use does not grow with it.
+ * @param job The import
+ * @param fp The roster
+ */
+void importTextRoster(struct ImportJob *job, FILE *fp) {
+    char fields[6][128 + 1];
+    int record = 0;
+    while (read_line(fp, fields[0], 128) > 0) {
+        int lines = 1;
+        while (lines < 6 && read_line(fp, fields[lines], 128) > 0) {
+            lines++;
+        }
+        record++;
+        if (lines < 6) {
+            printf("Skipped student %d, the roster ends part way through it.\n", record);
+            job->skipped++;
+            break;
+        }
+
+        struct Student student;
+        if (strlen(fields[0]) > 40 || strlen(fields[1]) > 40 || strlen(fields[2]) > 10) {
+            printf("Skipped student %d (%s), which does not fit a student file.\n", record, fields[2]);
+            job->skipped++;
+            continue;
+        }
+        strcpy(student.name, fields[0]);
+        strcpy(student.email, fields[1]);
+        strcpy(student.usf_id, fields[2]);
+        student.presentation_grade = strlen(fields[3]) == 1 ? gradeFromLetter(fields[3][0]) : -1;
+        student.essay_grade = strlen(fields[4]) == 1 ? gradeFromLetter(fields[4][0]) : -1;
+        student.term_project_grade = strlen(fields[5]) == 1 ? gradeFromLetter(fields[5][0]) : -1;
+        importStudent(job, &student);
+    }
+}
+
+/**
+ * Converts a grade of a students.bin record to a 0-4 grade
+ * @param grade The grade value
+ * @return The grade, or -1 if none was entered
+ */
+int gradeFromRoster(unsigned int grade) {
+    return grade <= 4 ? (int) grade : -1;
+}
+
+/**
+ * Saves the records of a students.bin roster as they are read, so only one is held in memory at a time
+ * @param job The import
+ * @param fp The roster file, positioned at its start
+ * @return 1 if every record was saved, 0 if the file is not a roster main.c can load, or -1 if it ends part way
+ * through its records
+ */
+int importRosterRecords(struct ImportJob *job, FILE *fp) {
+    struct RosterHeader header;
+    if (fread(&header, sizeof(header), 1, fp) != 1 || memcmp(header.magic, ROSTER_MAGIC, 4) != 0 ||
+        !((header.version == ROSTER_VERSION && header.record_size == sizeof(struct RosterRecord)) ||
+          (header.version == 1 && header.record_size == sizeof(struct RosterRecordV1)))) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < header.count; i++) {
+        struct Student student;
+        unsigned int grades[3];
+        if (header.version == ROSTER_VERSION) {
+            struct RosterRecord record;
+            if (fread(&record, sizeof(record), 1, fp) != 1) {
+                return -1;
+            }
+            unsigned int packed = record.grades[0] | record.grades[1] << 8;
+            for (int c = 0; c < 3; c++) {
+                grades[c] = packed >> (c * ROSTER_GRADE_BITS) & ((1 << ROSTER_GRADE_BITS) - 1);
+            }
+            memcpy(student.name, record.name, sizeof(student.name));
+            memcpy(student.email, record.email, sizeof(student.email));
+            memcpy(student.usf_id, record.uid, sizeof(student.usf_id));
+        } else {
+            struct RosterRecordV1 record;
+            if (fread(&record, sizeof(record), 1, fp) != 1) {
+                return -1;
+            }
+            for (int c = 0; c < 3; c++) {
+                grades[c] = record.grades[c];
+            }
+            memcpy(student.name, record.name, sizeof(student.name));
+            memcpy(student.email, record.email, sizeof(student.email));
+            memcpy(student.usf_id, record.uid, sizeof(student.usf_id));
+        }
+        student.name[40] = student.email[40] = student.usf_id[10] = '\0';
+        student.presentation_grade = gradeFromRoster(grades[0]);
+        student.essay_grade = gradeFromRoster(grades[1]);
+        student.term_project_grade = gradeFromRoster(grades[2]);
+        importStudent(job, &student);
+    }
+    return 1;
+}
 
 /**
- * Student data structure
+ * Reads the saved student a main.c UID was imported as
+ * @param uid The UID
+ * @return The student, which must be free()'d, or NULL if none was saved
  */
-struct Student {
-    char usf_id[10 + 1]; // +1 for null-terminator
-    char name[40 + 1]; // +1 for null-terminator
-    char email[40 + 1]; // +1 for null-terminator
-    int presentation_grade;
-    int essay_grade;
-    int term_project_grade;
-};
+struct Student *readRosterStudent(const char *uid) {
+    char usf_id[10 + 1];
+    if (usfIdFromUid(uid, usf_id) == 0) {
+        return NULL;
+    }
+    return readStudent(usf_id);
+}
 
 /**
- * Utility function to concatenating two strings together. If s1 = a and s2 = b, then s1 + s2 = ab
- * @param s1 String 1
- * @param s2 String 2
- * @return Concatenated string
+ * Takes a student replaced or removed by a journal change back out of the counts of an import
+ * @param job The import
+ * @param uid The main.c UID the student was imported with
  */
-char *concat(const char *s1, const char *s2) {
-    char *result = malloc(strlen(s1) + strlen(s2) + 1); // +1 for the null-terminator
-    if (result == NULL) {
-        printf("malloc() failed\n");
-        exit(-1);
+void uncountStudent(struct ImportJob *job, const char *uid) {
+    char usf_id[10 + 1];
+    job->imported--;
+    if (usfIdFromUid(uid, usf_id) == 2) {
+        job->padded--;
     }
-    strcpy(result, s1);
-    strcat(result, s2);
-    return result;
 }
 
 /**
- * Utility function for reading a line from a stream
- * @param stream The stream to read from
- * @param str The buffer to read in to
- * @param n The size of the buffer
- * @return The amount of characters read
+ * Replays the journal main.c keeps beside a students.bin roster over the students already saved from it. Each line
+ * is a tab separated change: A adds or replaces a student, U replaces the student with an old UID, and R removes
+ * one. A partially written last line is ignored, as main.c does.
+ * @param job The import, whose count of imported students follows the changes
+ * @param path The journal
+ * @return The number of changes replayed
  */
-int read_line(FILE *stream, char str[], int n) {
-    int ch, i = 0;
+int replayRosterJournal(struct ImportJob *job, const char *path) {
+    char line[512 + 1];
+    int changes = 0;
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return 0;
+    }
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        char *fields[8];
+        int n = 0;
+        if (strchr(line, '\n') == NULL) {
+            break;
+        }
+        line[strcspn(line, "\r\n")] = '\0';
+        fields[n++] = line;
+        for (char *ptr = line; *ptr != '\0' && n < 8; ptr++) {
+            if (*ptr == '\t') {
+                *ptr = '\0';
+                fields[n++] = ptr + 1;
+            }
+        }
 
-    while (isspace(ch = getc(stream)));
-    str[i++] = ch;
-    while ((ch = getc(stream)) != '\n') {
-        if (i < n)
-            str[i++] = ch;
+        struct Student *old_student;
+        if ((line[0] == 'A' && n == 7) || (line[0] == 'U' && n == 8)) {
+            struct Student student;
+            int first = line[0] == 'A' ? 1 : 2;
+            if (strlen(fields[first]) > 40 || strlen(fields[first + 1]) > 40 || strlen(fields[first + 2]) > 10) {
+                continue;
+            }
+            strcpy(student.name, fields[first]);
+            strcpy(student.email, fields[first + 1]);
+            strcpy(student.usf_id, fields[first + 2]);
+            student.presentation_grade = gradeFromLetter(fields[first + 3][0]);
+            student.essay_grade = gradeFromLetter(fields[first + 4][0]);
+            student.term_project_grade = gradeFromLetter(fields[first + 5][0]);
+            const char *old_uid = line[0] == 'A' ? fields[3] : fields[1];
+            old_student = readRosterStudent(old_uid);
+            if (old_student != NULL || line[0] == 'A') {
+                bool replaced = old_student != NULL && strcmp(old_uid, student.usf_id) == 0;
+                if (old_student != NULL && !replaced) {
+                    // A changed UID is saved as a new student in place of the old one
+                    deleteStudent(old_student);
+                    uncountStudent(job, old_uid);
+                }
+                if (importStudent(job, &student) && replaced) {
+                    uncountStudent(job, old_uid);
+                }
+            }
+            free(old_student);
+            changes++;
+        } else if (line[0] == 'R' && n == 2) {
+            if ((old_student = readRosterStudent(fields[1])) != NULL) {
+                deleteStudent(old_student);
+                uncountStudent(job, fields[1]);
+                free(old_student);
+            }
+            changes++;
+        }
     }
-    str[i] = '\0';
-    return i;
+    fclose(fp);
+    return changes;
 }
 
 /**
- * Loads a student from a file. This method uses malloc() so the returned value must be free()
- * @param file The text file to load from
- * @return The student read from the text file
+ * Builds the path of the journal in the same directory as a roster
+ * @param path The roster
+ * @return The journal path, which must be free()'d
  */
-struct Student *loadStudent(struct dirent *file) {
+char *rosterJournalPath(const char *path) {
+    const char *slash = strrchr(path, '/');
+#if defined(_WIN32)
+    if (strrchr(path, '\\') > slash) {
+        slash = strrchr(path, '\\');
+    }
+#endif
+    char *journal_path = malloc((slash == NULL ? 0 : slash - path + 1) + strlen(ROSTER_JOURNAL) + 1);
+    if (journal_path == NULL) {
+        printf("malloc() failed\n");
+        exit(-1);
+    }
+    size_t length = slash == NULL ? 0 : slash - path + 1;
+    memcpy(journal_path, path, length);
+    strcpy(journal_path + length, ROSTER_JOURNAL);
+    return journal_path;
+}
 
-    // Build the file path to save the student under
-    FILE *fp;
-    char *path = concat("student_data/", file->d_name);
-	  fp = fopen(path, "r");      //CHANGED FROM 'fclose(path)' TO 'fopen(path, "r")'
-    free(path);
+/**
+ * Saves every student of a roster main.c wrote: either students.bin with the journal beside it replayed, which is
+ * what main.c saves to, or a six line per student students.txt. The saves are written in groups of
+ * SAVE_MAX_PENDING. Students are saved as they are read, and the journal is then replayed over the saved files.
+ * @param path The roster to read
+ */
+void importStudents(const char *path) {
+    struct ImportJob job = {0};
+    char magic[4];
 
+    // A students.bin roster starts with ROSTER_MAGIC, anything else is read as students.txt
+    FILE *fp = fopen(path, "rb");
+    bool binary = fp != NULL && fread(magic, sizeof(magic), 1, fp) == 1 && memcmp(magic, ROSTER_MAGIC, 4) == 0;
+    if (fp != NULL && !binary) {
+        fclose(fp);
+        fp = fopen(path, "r");
+    }
     if (fp == NULL) {
         printf("File not opened, errno = %d\n", errno);
-        return NULL;
+        return;
     }
 
-    // Allocate memory for a new student structure to read
-    struct Student *student = malloc(sizeof(struct Student));
-
-    /* Read the contents of the text file */
-    read_line(fp, student->usf_id, 10);
-    read_line(fp, student->name, 40);
-    read_line(fp, student->email, 40);
-
-    char grade_buffer[2];
-
-    read_line(fp, grade_buffer, 1);
-    student->presentation_grade = atoi(grade_buffer);
-
-    read_line(fp, grade_buffer, 1);
-    student->essay_grade = atoi(grade_buffer);
-
-    read_line(fp, grade_buffer, 1);
-    student->term_project_grade = atoi(grade_buffer);
-
+    // Queue the saves so each group is written at once
+    batch_saves = true;
+    if (binary) {
+        rewind(fp);
+        int read = importRosterRecords(&job, fp);
+        if (read == 0) {
+            printf("%s is not a roster main.c can load.\n", path);
+        } else if (read == -1) {
+            printf("%s ends part way through its records, so its journal was not replayed.\n", path);
+        } else {
+            // Each change goes straight to the saved files it applies to
+            batch_saves = false;
+            commitSaves();
+            char *journal_path = rosterJournalPath(path);
+            int changes = replayRosterJournal(&job, journal_path);
+            if (changes > 0) {
+                printf("Replayed %d changes from %s.\n", changes, journal_path);
+            }
+            free(journal_path);
+        }
+    } else {
+        importTextRoster(&job, fp);
+    }
+    batch_saves = false;
+    commitSaves();
     fclose(fp);
+    if (job.padded > 0) {
+        printf("Padded %d USF IDs shorter than 10 digits with leading zeros.\n", job.padded);
+    }
+    printf("Imported %d students from %s, skipped %d.\n", job.imported, path, job.skipped);
+}
 
-    return student;
+/**
+ * Progress of an export through student_data
+ */
+struct ExportJob {
+    FILE *fp;
+    bool binary; // Writing students.bin records instead of students.txt lines
+    int dir_fd;
+    int exported;
+    int skipped;
+    int unnumbered; // Skipped as their USF IDs are not all digits, which main.c requires of a UID
+};
 
+/**
+ * Writes a student to a students.txt or students.bin roster
+ * @param job The export
+ * @param student The student
+ */
+void exportStudent(struct ExportJob *job, const struct Student *student) {
+    char presentation = letterFromGrade(student->presentation_grade);
+    char essay = letterFromGrade(student->essay_grade);
+    char term_project = letterFromGrade(student->term_project_grade);
+    if (presentation == '?' || essay == '?' || term_project == '?') {
+        printf("Skipped %s, whose grades are not 0-4.\n", student->usf_id);
+        job->skipped++;
+        return;
+    }
+    if (student->usf_id[strspn(student->usf_id, "0123456789")] != '\0') {
+        printf("Skipped %s, whose USF ID is not all digits.\n", student->usf_id);
+        job->skipped++;
+        job->unnumbered++;
+        return;
+    }
+    if (job->binary) {
+        struct RosterRecord record;
+        unsigned int packed = student->presentation_grade | student->essay_grade << ROSTER_GRADE_BITS |
+                              student->term_project_grade << (2 * ROSTER_GRADE_BITS);
+        memset(&record, 0, sizeof(record));
+        strcpy(record.name, student->name);
+        strcpy(record.email, student->email);
+        strcpy(record.uid, student->usf_id);
+        record.grades[0] = packed & 0xff;
+        record.grades[1] = packed >> 8;
+        fwrite(&record, sizeof(record), 1, job->fp);
+    } else {
+        fprintf(job->fp, "%s\n%s\n%s\n%c\n%c\n%c\n", student->name, student->email, student->usf_id,
+                presentation, essay, term_project);
+    }
+    job->exported++;
 }
 
-/** WORKING?
- * Saves a student to a text file. The file and directory are automatically created if they do not already exist.
- * @param student The student data to save
- * @return If the operation was a success
+/**
+ * Exports a student file found while walking student_data. A flat file with a sharded copy is skipped, as the
+ * sharded copy is the one read.
+ * @param path The path of a file or shard directory relative to student_data
+ * @param is_directory If it is a shard directory
+ * @param context The export
  */
-bool saveStudent(struct Student *student) {
+void exportVisit(const char *path, bool is_directory, void *context) {
+    struct ExportJob *job = context;
+    struct Student student;
+    const char *name = baseName(path);
+    size_t length = strlen(name);
+    if (is_directory || name[0] == '.') {
+        return;
+    }
+    if (name == path && length > 4 && length - 4 <= 10 && strcmp(name + length - 4, ".txt") == 0) {
+        char usf_id[10 + 1];
+        char sharded[STUDENT_PATH_MAX];
+        struct stat st = {0};
+        memcpy(usf_id, name, length - 4);
+        usf_id[length - 4] = '\0';
+        studentPath(usf_id, true, sharded);
+        if (stat(sharded, &st) == 0) {
+            return;
+        }
+    }
+    if (readStudentFile(job->dir_fd, path, &student)) {
+        exportStudent(job, &student);
+    }
+}
 
-    struct stat st = {0};
+/**
+ * Writes every stored student to a roster main.c reads: students.bin, which main.c saves to, if path ends in .bin,
+ * otherwise students.txt with letter grades, which main.c only reads when it has no students.bin. Students are read
+ * one at a time, so memory use does not grow with the roster. The roster is written to a temporary file first so a
+ * failed export leaves any earlier roster in place.
+ * @param path The roster to write
+ */
+void exportStudents(const char *path) {
+    struct ExportJob job = {0};
+    struct RosterHeader header;
+    char *tmp_path = concat(path, ".tmp");
+    size_t length = strlen(path);
 
-    // Create the student_data directory if it does not already exist
-	  if (stat("student_data", &st) == -1) {      //ADDED ALL CODE OTHER THAN 'if' AND 'mkdir'
-		    #if defined(_WIN32)
-			      mkdir("student_data");
-		    #else
-			      mkdir("student_data", 0700);
-  		  #endif
-	  }
+    job.binary = length >= 4 && strcmp(path + length - 4, ".bin") == 0;
+    job.fp = fopen(tmp_path, job.binary ? "wb" : "w");
+    if (job.fp == NULL) {
+        printf("Error opening file!\n");
+        free(tmp_path);
+        return;
+    }
+    if (job.binary) {
+        // The count is filled in once every student is written
+        memcpy(header.magic, ROSTER_MAGIC, 4);
+        header.version = ROSTER_VERSION;
+        header.count = 0;
+        header.record_size = sizeof(struct RosterRecord);
+        fwrite(&header, sizeof(header), 1, job.fp);
+    }
+    if (log_enabled) {
+        for (int i = 0; i < log_entry_count; i++) {
+            struct Student *student = logReadEntry(i);
+            if (student != NULL) {
+                exportStudent(&job, student);
+                free(student);
+            }
+        }
+    } else {
+        // Pending saves are not in student_data until they are committed
+        commitSaves();
+#if defined(_WIN32)
+        job.dir_fd = -1;
+#else
+        job.dir_fd = open("student_data", O_RDONLY | O_DIRECTORY);
+#endif
+        walkStudentData(exportVisit, &job);
+#if !defined(_WIN32)
+        if (job.dir_fd != -1) {
+            close(job.dir_fd);
+        }
+#endif
+    }
+    if (job.binary) {
+        header.count = job.exported;
+        fseek(job.fp, 0, SEEK_SET);
+        fwrite(&header, sizeof(header), 1, job.fp);
+    }
+    if (fsync_policy != FSYNC_NONE) {
+        syncFile(job.fp);
+    }
+    bool written = !ferror(job.fp);
+    if (fclose(job.fp) != 0 || !written) {
+        printf("Error saving file!\n");
+        remove(tmp_path);
+        free(tmp_path);
+        return;
+    }
+#if defined(_WIN32)
+    remove(path); // rename() does not replace an existing file on Windows
+#endif
+    if (rename(tmp_path, path) != 0) {
+        printf("Error saving file!\n");
+    } else {
+        printf("Exported %d students to %s, skipped %d.\n", job.exported, path, job.skipped);
+        if (job.unnumbered > 0) {
+            printf("Skipped %d students whose USF IDs main.c cannot load as UIDs.\n", job.unnumbered);
+        }
+        if (job.binary) {
+            // The journal holds changes to the roster just replaced, replaying them would undo the export
+            char *journal_path = rosterJournalPath(path);
+            if (remove(journal_path) == 0) {
+                printf("Removed %s, which held changes to the replaced roster.\n", journal_path);
+            }
+            free(journal_path);
+        }
+    }
+    free(tmp_path);
+}
 
-    // Build the file path to save the student under
-    char *partial_path = concat("student_data/", student->usf_id);      //CHANGED FROM 'partial_path' TO '*partial_path'
-    char *path = concat(partial_path, ".txt");
+/**
+ * Writes the gathered output to stdout
+ */
+void outputFlush() {
+    if (output_used > 0) {
+        fwrite(output_buffer, 1, output_used, stdout);
+        output_used = 0;
+    }
+}
 
-    free(partial_path);
+/**
+ * Adds text to the output buffer, flushing first if it does not fit
+ * @param text The text
+ * @param length The length of the text
+ */
+void outputWrite(const char *text, size_t length) {
+    if (output_used + length > OUTPUT_BUFFER_SIZE) {
+        outputFlush();
+        if (length > OUTPUT_BUFFER_SIZE) {
+            fwrite(text, 1, length, stdout);
+            return;
+        }
+    }
+    memcpy(output_buffer + output_used, text, length);
+    output_used += length;
+}
 
-    // Open the text file for writing
-    FILE *fp = fopen(path, "w");
-    free(path);
+/**
+ * Adds a string to the output buffer
+ * @param text The string
+ */
+void outputText(const char *text) {
+    outputWrite(text, strlen(text));
+}
 
-    if (fp == NULL) {
-        printf("Error opening file!\n");
-        exit(1);
+/**
+ * Adds a string to the output buffer, padded with spaces to a width
+ * @param text The string
+ * @param width The width to pad to
+ */
+void outputPadded(const char *text, int width) {
+    static const char spaces[] = "                                        ";
+    int length = (int) strlen(text);
+    outputWrite(text, length);
+    while (length < width) {
+        int pad = width - length < (int) sizeof(spaces) - 1 ? width - length : (int) sizeof(spaces) - 1;
+        outputWrite(spaces, pad);
+        length += pad;
     }
+}
 
-    // Write to the text file
-    fprintf(fp,
-            "%s\n%s\n%s\n%d\n%d\n%d\n",
-            student->usf_id,
-            student->name,
-            student->email,
-            student->presentation_grade,
-            student->essay_grade,
-            student->term_project_grade
-    );
+/**
+ * Adds a number to the output buffer, padded with spaces to a width
+ * @param number The number
+ * @param width The width to pad to, 0 for none
+ */
+void outputNumber(int number, int width) {
+    char digits[12];
+    int length = 0;
+    unsigned int value = number < 0 ? 0u - (unsigned int) number : (unsigned int) number;
+    char text[13];
 
-    // Close the text file
-    fclose(fp);
-    
-    return true;
+    do {
+        digits[length++] = (char) ('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    int pos = 0;
+    if (number < 0) {
+        text[pos++] = '-';
+    }
+    while (length > 0) {
+        text[pos++] = digits[--length];
+    }
+    text[pos] = '\0';
+    outputPadded(text, width);
 }
 
 /**
- * Deletes the file associated with the student. This method does not free() the *student parameter.
- * @param student The student with the file to delete
- * @return If the delete operation was successful
+ * Column widths of a student table. Each is the width of the widest value or heading in the column.
  */
-bool deleteStudent(struct Student *student) {
-    // Build the full file path
-    char *partial_path = concat("student_data/", student->usf_id);
-    char *path = concat(partial_path, ".txt");
-    free(partial_path);
+struct TableWidths {
+    int usf_id;
+    int name;
+    int email;
+};
 
-    bool result = false;
+/**
+ * Sets table widths to fit just the headings
+ * @param widths The widths
+ */
+void tableWidthsInit(struct TableWidths *widths) {
+    widths->usf_id = 2; // "ID"
+    widths->name = 4; // "Name"
+    widths->email = 5; // "Email"
+}
 
-    // Delete the file
-    if (remove(path) == 0) {
-        result = true;
-    } else {
-        result = false;
+/**
+ * Widens table columns to fit a student
+ * @param widths The widths
+ * @param student The student
+ */
+void tableWidthsAdd(struct TableWidths *widths, const struct Student *student) {
+    int length;
+    if ((length = (int) strlen(student->usf_id)) > widths->usf_id) {
+        widths->usf_id = length;
+    }
+    if ((length = (int) strlen(student->name)) > widths->name) {
+        widths->name = length;
+    }
+    if ((length = (int) strlen(student->email)) > widths->email) {
+        widths->email = length;
     }
+}
 
-    // De-allocate resources
-    free(path);
-    return result;
+/**
+ * Adds the heading row of a student table to the output buffer
+ * @param widths The column widths
+ */
+void outputTableHeader(const struct TableWidths *widths) {
+    outputPadded("ID", widths->usf_id + 2);
+    outputPadded("Name", widths->name + 2);
+    outputPadded("Email", widths->email + 2);
+    outputText("Presentation Grade  Essay Grade  Project Grade\n");
+}
+
+/**
+ * Adds a row of a student table to the output buffer
+ * @param widths The column widths
+ * @param student The student
+ */
+void outputTableRow(const struct TableWidths *widths, const struct Student *student) {
+    outputPadded(student->usf_id, widths->usf_id + 2);
+    outputPadded(student->name, widths->name + 2);
+    outputPadded(student->email, widths->email + 2);
+    outputNumber(student->presentation_grade, 20); // Under "Presentation Grade  "
+    outputNumber(student->essay_grade, 13); // Under "Essay Grade  "
+    outputNumber(student->term_project_grade, 0);
+    outputWrite("\n", 1);
+}
+
+/**
+ * Adds a student to the output buffer, one "Field: value" line per field
+ * @param student The student
+ */
+void outputStudent(const struct Student *student) {
+    outputText("ID: ");
+    outputText(student->usf_id);
+    outputText("\nName: ");
+    outputText(student->name);
+    outputText("\nEmail: ");
+    outputText(student->email);
+    outputText("\nPresentation Grade: ");
+    outputNumber(student->presentation_grade, 0);
+    outputText("\nEssay Grade: ");
+    outputNumber(student->essay_grade, 0);
+    outputText("\nProject Grade: ");
+    outputNumber(student->term_project_grade, 0);
+    outputWrite("\n", 1);
 }
 
 /**
- * Function designed to handle the SIGINT signal
+ * Set by stop() once SIGINT arrives. The command loop then commits and exits.
+ */
+volatile sig_atomic_t stop_requested = 0;
+
+/**
+ * Function designed to handle the SIGINT signal. Only a flag is set here: committing takes save_lock, which the
+ * interrupted thread may already hold.
  * @param signal The signal
  */
 void stop(int signal) {
-    free(selected_student);
-    printf("Thank you and goodbye.\n");
-    exit(0);
+    stop_requested = signal;
 }
 
 /**
@@ -197,18 +3646,70 @@ void stop(int signal) {
 int main() {
 
     // Handle SIGINT in stop(int) function
+#if defined(_WIN32)
     signal(SIGINT, &stop);
+#else
+    // Without SA_RESTART the signal interrupts the wait for the next command, so the loop sees it straight away
+    struct sigaction action = {0};
+    action.sa_handler = &stop;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+#endif
 
     printf("Initialized simple class-roll maintenance system. Type \"help\" for a list of commands.\n");
     printf("To quit, terminate the program with ctrl+c or send a SIGINT signal.\n");
 
+    // Load student_data in to memory once, later commands only re-read files that change
+    struct stat st = {0};
+    if (stat("student_data", &st) == -1) {
+        #if defined(_WIN32)
+            mkdir("student_data");
+        #else
+            mkdir("student_data", 0700);
+        #endif
+    }
+    openLayout();
+    openSaves();
+
+    const char *storage = getenv("STUDENT_STORAGE");
+    if (storage != NULL && strcasecmp(storage, "log") == 0) {
+        // Keep students in student_log segments instead of one file each
+        logOpen();
+        printf("Using log-structured storage in student_log.\n");
+    } else {
+        cacheOpen();
+    }
+
+    // Build the name and email indexes the first time they are needed
+    if (stat("student_index", &st) == -1) {
+        indexRebuild();
+    }
+
     char command[20];
 
     while (true) {
 
         int operation;      //ADDED DECLARATION OF 'int operation'
 
-        scanf("%s", command);
+        // Reclaim obsolete log records between commands
+        logCompact();
+
+        // Without a group commit thread, commit before waiting for the next command
+        if (fsync_policy == FSYNC_GROUP && !group_thread) {
+            commitSaves();
+        }
+
+        if (stop_requested) {
+            break;
+        }
+        if (scanf("%s", command) != 1) {
+            // Interrupted by SIGINT, or out of input
+            if (stop_requested || feof(stdin)) {
+                break;
+            }
+            clearerr(stdin);
+            continue;
+        }
 
         //commands
         if (strcasecmp(command, "help") == 0) {
@@ -219,6 +3720,12 @@ int main() {
             printf("delete\t- Deletes a selected student\n");
             printf("edit\t- Edits data about a selected student\n");
             printf("list\t- Views a list of all available students\n");
+            printf("show\t- Shows every field of the selected student\n");
+            printf("reindex\t- Rebuilds the name and email indexes from student_data\n");
+            printf("migrate\t- Moves student_data to the sharded layout, student_data/ab/cd/<usf id>.txt\n");
+            printf("import <file>\t- Adds a main.c roster, students.bin and its journal or students.txt\n");
+            printf("export <file>\t- Writes every student to a main.c roster, students.bin if <file> ends in .bin\n");
+            printf("stats\t- Shows how many records scans visited and the heap allocations they made\n");
             printf("quit\t- Quits the program\n");
         } else 
         
@@ -235,27 +3742,56 @@ int main() {
 			      }
 
             DIR *dir;
-            struct dirent *ent;
             struct Student *student;
+            struct TableWidths widths;
+            tableWidthsInit(&widths);
             printf("----\n");
+            cacheRefresh();
+            if (log_enabled) {
+                // Records are read one at a time, so size the columns for the longest possible values
+                widths.usf_id = 10;
+                widths.name = 40;
+                widths.email = 40;
+                outputTableHeader(&widths);
+                // Read each student through the offset index
+                for (int i = 0; i < log_entry_count; i++) {
+                    student = logReadEntry(i);
+                    if (student != NULL) {
+                        outputTableRow(&widths, student);
+                        free(student);
+                    }
+                }
+            } else if (cache_enabled) {
+                // Serve the list from memory, in file name order like a scan
+                cacheSort();
+                for (int i = 0; i < cache_count; i++) {
+                    tableWidthsAdd(&widths, &cache[i].student);
+                }
+                outputTableHeader(&widths);
+                for (int i = 0; i < cache_count; i++) {
+                    outputTableRow(&widths, &cache[i].student);
+                }
+            } else
             // Open the student_data directory for reading
             if ((dir = opendir("student_data")) != NULL) {      //CHANGED FROM "student-data" TO "student_data"
-                printf("ID\t\tName\t\tEmail\t\t\tPresentation Grade\tEssay Grade\tProject Grade\n");      //CHANGED TABS
-                // Loop through all of the contents within the student_data directory
-                while ((ent = readdir(dir)) != NULL) {
-                    if (ent->d_type == DT_REG) { // Files only
-                        // Load the student from the found file
-                        student = loadStudent(ent);      //CHANGED FROM 'loadstudent' TO 'loadStudent'
+                closedir(dir);
+                // Read every file in student_data on several threads, then print them in file name order
+                int count = scanDirectory();
+                loadStudents(count);
+                for (int i = 0; i < count; i++) {
+                    if (scan_arena.loaded[i]) {
+                        tableWidthsAdd(&widths, &scan_arena.students[i]);
+                    }
+                }
+                outputTableHeader(&widths);
+                for (int i = 0; i < count; i++) {
+                    if (scan_arena.loaded[i]) {
                         // Print out the information about the student
-                        printf("%s\t%s\t%s\t\t%d\t\t\t%d\t\t%d\n", student->usf_id, student->name,
-                               student->email,
-                               student->presentation_grade, student->essay_grade, student->term_project_grade);
-                        // Because loadStudent() uses malloc(), we need to free it
-                        free(student);
+                        outputTableRow(&widths, &scan_arena.students[i]);
                     }
                 }
-                closedir(dir);
             }
+            outputFlush();
             printf("----\n");
         } else 
         
@@ -264,42 +3800,10 @@ int main() {
             // Read the search criteria entered by the user
             char needle[128 + 1];      //CHANGED FROM '*needle' TO 'needle[128]'
             read_line(stdin, needle, 128);
-            struct Student *student = NULL;
-            struct stat st = {0};
-            // Create the student_data directory if it does not already exist
-      			if (stat("student_data", &st) == -1) {      //ADDED ALL CODE OTHER THAN 'if' AND 'mkdir'
-      				#if defined(_WIN32)
-      					mkdir("student_data");
-      				#else 
-      					mkdir("student_data", 0700);
-      				#endif
-      			}
-
-            DIR *dir;
-            struct dirent *ent;
-            // Open the student_data directory for reading
-            if ((dir = opendir("student_data")) != NULL) {
-                // Loop through all of the contents within the student_data directory
-                while ((ent = readdir(dir)) != NULL) {
-                    if (ent->d_type == DT_REG) { // Files only
-                        // Load the student from the found file
-                        student = loadStudent(ent);      //ADDED "student = loadStudent(ent)"
-                        // Determine if either the ID, Name, or Email match what the user searched for
-                        if (strcasecmp(student->usf_id, needle) == 0 || strcasecmp(student->name, needle) == 0 ||
-                            strcasecmp(student->email, needle) == 0) {
-                            break;      //ADDED "break;"
-                        } else {
-                            free(student);
-                            student = NULL;
-                        }
-                    }
-                }
-                closedir(dir);
-            } else {
-                perror("Search");
-            }
+            struct Student *student = findStudent(needle);
             if (student != NULL) {
                 printf("Selected student %s (%s, %s)\n", student->name, student->usf_id, student->email);
+                free(selected_student);
                 selected_student = student;
             } else {
                 printf("No student found with search criteria.\n");
@@ -422,6 +3926,51 @@ int main() {
             }
         } else 
         
+        //scan statistics
+        if (strcasecmp(command, "stats") == 0) {
+            printf("Scans: %lu\n", scan_count);
+            printf("Records visited: %lu\n", scan_records);
+            printf("Heap allocations: %lu (%.4f per record)\n", scan_allocations,
+                   scan_records > 0 ? (double) scan_allocations / scan_records : 0.0);
+            printf("Last scan: %lu records, %lu heap allocations\n", last_scan_records, last_scan_allocations);
+        } else
+
+        //show selected
+        if (strcasecmp(command, "show") == 0) {
+            if (selected_student == NULL) {
+                printf("Error: No student selected.\n");
+                continue;
+            }
+            outputStudent(selected_student);
+            outputFlush();
+        } else
+
+        //rebuild indexes
+        if (strcasecmp(command, "reindex") == 0) {
+            indexRebuild();
+            printf("Rebuilt the name and email indexes.\n");
+        } else
+
+        //move to the sharded layout
+        if (strcasecmp(command, "migrate") == 0) {
+            if (log_enabled) {
+                printf("Error: The log backend does not use student_data.\n");
+                continue;
+            }
+            migrateStudents();
+        } else
+
+        //convert from and to students.txt
+        if (strcasecmp(command, "import") == 0 || strcasecmp(command, "export") == 0) {
+            char path[256 + 1];
+            read_line(stdin, path, 256);
+            if (strcasecmp(command, "import") == 0) {
+                importStudents(path);
+            } else {
+                exportStudents(path);
+            }
+        } else
+
         //quit
         if (strcasecmp(command, "quit") == 0 || strcasecmp(command, "stop") == 0) {
             break; // Break from the infinite loop
@@ -430,7 +3979,10 @@ int main() {
         }
     }
 
+    commitSaves();
     free(selected_student);
+    cacheClose();
+    logClose();
     printf("Thank you and goodbye.\n");
     return 0;
 }
@@ -18,11 +18,46 @@
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdint.h>
+#include <time.h>
+#include <errno.h>
+#if defined(_WIN32)
+#include <io.h>                             //_chsize, to truncate the journal
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>                        //link with -pthread on C libraries older than glibc 2.34
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_AVX2                           //AVX2 kernels are built, and used if the CPU has AVX2
+#endif
+#if defined(__SSE2__) || defined(HAVE_AVX2)
+#include <immintrin.h>
+#endif
 
 /* global constants / definitions */
 #define BUFFER 10000                        //large integer
 #define MAX_ID 10
 #define MAX_STRING 40
+#define ROSTER_FILE "students.bin"          //binary save file, see roster_header
+#define TEXT_FILE "students.txt"            //legacy six line save file, imported if ROSTER_FILE is missing
+#define JOURNAL_FILE "students.journal"     //append-only log of changes since ROSTER_FILE was written
+#define JOURNAL_MAX_BYTES (1 << 20)         //journal size that triggers rewriting ROSTER_FILE
+#define ROSTER_MAGIC "SRBF"                 //first 4 bytes of ROSTER_FILE
+#define ROSTER_VERSION 2                    //version 1 files, with a byte per grade, are still read
+#define SEGMENT_SHIFT 10
+#define SEGMENT_SIZE (1 << SEGMENT_SHIFT)   //students per segment of Students
+#define LOAD_MAX_THREADS 16                 //most threads used to load TEXT_FILE
+#define LOAD_MIN_BYTES (1 << 20)            //smallest part of TEXT_FILE worth its own thread
+#define CSV_CHUNK (1 << 20)                 //bytes read or written at a time by CSV import/export
+#define CSV_HEADER "name,email,uid,presentation,essay,project"    //header row written by export_csv
+#define SKIP_LEVELS 24                      //most levels of a skip list node, enough for 2^24 students
+#define TRIGRAM_BUCKETS (1 << 16)           //number of posting lists in a trigram index
+#define COMPACT_RATIO 0.25                  //default fraction of removed slots that triggers compaction
+#define OUTPUT_BUFFER (1 << 16)             //bytes of output gathered before each write to stdout
+#define GRADE_LEVELS 5                      //number of grade values, F through A
 
 /* boolean type because C doesn't have one */
 #define true 1
@@ -34,35 +69,249 @@ typedef enum gradeType{
     F, D, C, B, A, ERR
 } grade;
 
-/* Structure that holds student information inside
-*  the global array */
+/* Grade components of a student, in the order they are packed */
+typedef enum componentType{
+    PRESENTATION, ESSAY, PROJECT
+} component;
+
+/* All three grades of a student packed into one 16 bit word,
+*  GRADE_BITS per component, see get_grade and pack_grades */
+typedef uint16_t packed_grades;
+#define GRADE_BITS 3
+#define GRADE_MASK ((1 << GRADE_BITS) - 1)
+
+/* Structure that holds one whole student as it is read from files
+*  and prompts, and passed to append_student and replace_student */
 typedef struct studentInfo{
     char name[MAX_STRING + 1];              //40 char long, +1 for null char
     char email[MAX_STRING + 1];             //40 char long, +1 for null char
     char id[MAX_ID + 1];                    //10 char long, +1 for null char
-    grade presentation;                     //enum value
-    grade essay;                            //enum value
-    grade project;                          //enum value
+    packed_grades grades;                   //presentation, essay and project grades
 } student;
 
+/* Strings and links of one slot inside the global array. Grades
+*  are kept apart in the Grades column, see student_at and grades_at */
+typedef struct studentRecord{
+    char name[MAX_STRING + 1];              //40 char long, +1 for null char
+    char email[MAX_STRING + 1];             //40 char long, +1 for null char
+    char id[MAX_ID + 1];                    //10 char long, +1 for null char
+    char nameKey[MAX_STRING + 1];           //name folded to lower case, set when stored
+    char emailKey[MAX_STRING + 1];          //email folded to lower case, set when stored
+    int prev;                               //previous student in listing order, -1 if first
+    int next;                               //next student in listing order (or free slot), -1 if last
+    bool removed;                           //true if slot is a tombstone on the free list
+} student_record;
+
+/* Header at the start of ROSTER_FILE, followed by count records
+*  of recordSize bytes each. Stored in native byte order */
+typedef struct rosterHeader{
+    char magic[4];                          //ROSTER_MAGIC
+    uint32_t version;                       //ROSTER_VERSION
+    uint32_t count;                         //number of records
+    uint32_t recordSize;                    //sizeof(roster_record)
+} roster_header;
+
+/* Fixed size layout of one student inside ROSTER_FILE */
+typedef struct rosterRecord{
+    char name[MAX_STRING + 1];              //null padded
+    char email[MAX_STRING + 1];             //null padded
+    char id[MAX_ID + 1];                    //null padded
+    uint8_t grades[2];                      //packed_grades, low byte first
+} roster_record;
+
+/* Layout of one student inside a version 1 ROSTER_FILE */
+typedef struct rosterRecordV1{
+    char name[MAX_STRING + 1];              //null padded
+    char email[MAX_STRING + 1];             //null padded
+    char id[MAX_ID + 1];                    //null padded
+    uint8_t presentation;                   //grade value
+    uint8_t essay;                          //grade value
+    uint8_t project;                        //grade value
+} roster_record_v1;
+
+/* Part of TEXT_FILE loaded by one thread. Starts at the beginning
+*  of a line, the last record may run past end */
+typedef struct loadChunk{
+    const char *start;                      //first byte of chunk
+    const char *end;                        //one past last byte of chunk
+    const char *fileEnd;                    //one past last byte of file
+    long lines;                             //non-blank lines before chunk, then inside it
+    student *students;                      //students parsed from chunk
+    int count;                              //number of students parsed
+    int max;                                //number of students allocated
+} load_chunk;
+
+/* Fields a student can be searched by, in find_student menu order,
+*  then FIELD_GPA which students can only be sorted by */
+typedef enum fieldType{
+    FIELD_NAME, FIELD_EMAIL, FIELD_UID, FIELD_GPA
+} field;
+
+/* Open addressing hash table that maps a field value
+*  to the index of its student, see student_at */
+#define EMPTY_SLOT -1
+#define DELETED_SLOT -2
+#define INDEX_MIN_SIZE 16                   //initial number of slots, must be a power of 2
+
+typedef struct hashIndex{
+    int *slots;                             //student index, EMPTY_SLOT or DELETED_SLOT
+    unsigned int *hashes;                   //hash of the key of each slot, saves rehashing on resize
+    int size;                               //number of slots allocated, always a power of 2
+    int filled;                             //number of slots holding a student
+    int used;                               //number of slots that are not EMPTY_SLOT
+} hash_index;
+
+/* Node of a skip list holding students in order of one field */
+typedef struct skipNode{
+    int student;                            //student index
+    int levels;                             //number of entries in next
+    struct skipNode *next[];                //following node on each level
+} skip_node;
+
+/* Skip list over student indexes, ordered by a field then by index.
+*  Built on first use, kept in order on every change after that */
+typedef struct skipList{
+    skip_node *head;                        //sentinel node with SKIP_LEVELS levels
+    int levels;                             //number of levels in use
+    bool built;                             //false until first prefix search or sorted listing
+} skip_list;
+
+/* Trigram index: each 3 character substring of a field is hashed to a
+*  posting list of the students containing it. Removed or changed students
+*  are left in their lists and filtered out when searching */
+typedef struct trigramIndex{
+    int **lists;                            //TRIGRAM_BUCKETS posting lists of student indexes
+    int *lengths;                           //number of entries in each list
+    int *sizes;                             //number of entries allocated to each list
+    long postings;                          //entries in all lists
+    long stale;                             //entries left by removed or changed students
+    bool built;                             //false until first substring search
+} trigram_index;
+
+/* Histogram of one grade component across the roster */
+typedef struct gradeStats{
+    long counts[GRADE_LEVELS];              //students with each grade, indexed by grade value
+    long total;                             //students counted
+    long sum;                               //sum of their grade values
+} grade_stats;
+
+/* Student held by a ranking heap, with the score it was ranked on */
+typedef struct rankEntry{
+    double score;                           //grade value or GPA
+    unsigned long long uid;                 //numeric UID, ties on score rank by it
+    int student;                            //student index
+} rank_entry;
+
+/* Scores a ranking can order students by, the grade components then GPA */
+#define RANK_GPA 3
+
 /* global variables */
-student *Students;                          //holds all student information
-int count = 0;                              //index of Students, initially 0
-int max = 2;                                //number of student structs allocated to Students, initially 2
+student_record **Students;                  //segments holding the strings of every slot, see student_at
+packed_grades **Grades;                     //segments holding the grades of every slot, see grades_at
+int count = 0;                              //number of students, initially 0
+int slotCount = 0;                          //number of slots handed out, live or removed, initially 0
+int First = -1;                             //first student in listing order, -1 if none
+int Last = -1;                              //last student in listing order, -1 if none
+int FreeSlot = -1;                          //first removed slot ready for reuse, -1 if none
+double CompactRatio = COMPACT_RATIO;        //set with STUDENTS_COMPACT_RATIO environment variable
+int segments = 0;                           //number of segments allocated, initially 0
+int maxSegments = 0;                        //number of segment pointers allocated to Students, initially 0
+hash_index Indexes[3];                      //one index per field, Indexes[FIELD_UID] is unique
+skip_list Ordered[4];                       //every field in sorted order, for prefix search and sorted listing
+trigram_index Trigrams[2];                  //name and email trigrams, for substring search
+unsigned int LevelSeed = 2463534242u;       //state of random_level
+bool IgnoreCase = false;                    //true if name and email searches ignore case
+FILE *Journal = NULL;                       //open journal, appended to on every change
+long JournalBytes = 0;                      //current size of the journal
+char Output[OUTPUT_BUFFER];                 //output waiting for flush_output
+size_t OutputUsed = 0;                      //bytes of Output in use
+bool TableView = false;                     //true if students are listed as a table instead of field by field
 
 /* ================================================================================================================== */
 /* HELPER FUNCTIONS */
 
 /*
-    reallocates memory to Students if not sufficient
+    returns pointer to the strings and links of student index i
+    students live in fixed size segments that are never moved,
+    so the pointer stays valid while Students grows
+*/
+student_record *student_at(int i){
+    return &Students[i >> SEGMENT_SHIFT][i & (SEGMENT_SIZE - 1)];
+}
+
+/*
+    returns pointer to the grades of student index i
+    each segment of Students has a segment of Grades with the same slots,
+    a removed slot's grades are all ERR so grade scans can skip Students
+*/
+packed_grades *grades_at(int i){
+    return &Grades[i >> SEGMENT_SHIFT][i & (SEGMENT_SIZE - 1)];
+}
+
+/*
+    allocates another segment to Students and Grades if slot index slotCount has no room
+    only the small tables of segment pointers are ever reallocated
 */
 void add_student_memory(){
-    //if # of filled students equals amount allocated,
-    //reallocate Students with power 2 of current number
-    if(count == max){
-        max *= max;
-        Students = realloc(Students, sizeof(student)*(max));
+    if(slotCount < segments * SEGMENT_SIZE){
+        return;
+    }
+
+    //double tables of segment pointers when full
+    if(segments == maxSegments){
+        maxSegments = maxSegments == 0 ? 16 : maxSegments * 2;
+        Students = realloc(Students, sizeof(student_record *) * maxSegments);
+        Grades = realloc(Grades, sizeof(packed_grades *) * maxSegments);
+        if(Students == NULL || Grades == NULL){
+            printf("...memory not allocated\n");
+            exit(1);
+        }
+    }
+    Students[segments] = malloc(sizeof(student_record) * SEGMENT_SIZE);
+    Grades[segments] = malloc(sizeof(packed_grades) * SEGMENT_SIZE);
+    if(Students[segments] == NULL || Grades[segments] == NULL){
+        printf("...memory not allocated\n");
+        exit(1);
+    }
+    segments++;
+}
+
+/*
+    returns one grade of a packed word
+*/
+grade get_grade(packed_grades p, component c){
+    return (grade)((p >> (c * GRADE_BITS)) & GRADE_MASK);
+}
+
+/*
+    returns p with one grade replaced by g
+*/
+packed_grades set_grade(packed_grades p, component c, grade g){
+    return (packed_grades)((p & ~(GRADE_MASK << (c * GRADE_BITS))) | (g << (c * GRADE_BITS)));
+}
+
+/*
+    returns the three grades packed into one word
+*/
+packed_grades pack_grades(grade presentation, grade essay, grade project){
+    return (packed_grades)(presentation | essay << GRADE_BITS | project << (2 * GRADE_BITS));
+}
+
+/*
+    frees all segments of Students
+*/
+void free_students(){
+    for(int j = 0; j < segments; j++){
+        free(Students[j]);
+        free(Grades[j]);
     }
+    free(Students);
+    free(Grades);
+    Students = NULL;
+    Grades = NULL;
+    segments = 0;
+    maxSegments = 0;
+    slotCount = 0;
 }
 
 /* 
@@ -139,49 +388,116 @@ grade convert_char_to_grade(char c){
 
 
 /*
-    function to convert enum input into char
-    returns ? if character given is not A, B, C, D, or F
+    returns the three grade letters packed into one word
+    each letter that is not a grade is packed as ERR
 */
-char convert_grade_to_char(grade g){
-    char ret;
-    switch(g){
-        case A:     ret = 'A';
-            break;
-        case B:     ret = 'B';
-            break;
-        case C:     ret = 'C';
-            break;
-        case D:     ret = 'D';
-            break;
-        case F:     ret = 'F';
-            break;
-        default:    ret = '?';      //should never be returned
-            break;
+packed_grades pack_grade_chars(char presentation, char essay, char project){
+    return pack_grades(convert_char_to_grade(presentation), convert_char_to_grade(essay),
+                       convert_char_to_grade(project));
+}
+
+/*
+    writes the letters of the three grades of a packed word to text
+*/
+void unpack_grade_chars(packed_grades p, char *text){
+    static const char letters[] = "FDCBA???";   //indexed by grade, ? for ERR and unused values
+
+    text[0] = letters[p & GRADE_MASK];
+    text[1] = letters[(p >> GRADE_BITS) & GRADE_MASK];
+    text[2] = letters[(p >> (2 * GRADE_BITS)) & GRADE_MASK];
+}
+
+/*
+    function to write the output gathered in Output to stdout
+*/
+void flush_output(){
+    if(OutputUsed > 0){
+        fwrite(Output, 1, OutputUsed, stdout);
+        OutputUsed = 0;
     }
-    return ret;
 }
 
 /*
-    function to print a student struct
+    function to add text to Output, flushing first if it does not fit
+*/
+void write_output(const char *text, size_t length){
+    if(OutputUsed + length > OUTPUT_BUFFER){
+        flush_output();
+        if(length > OUTPUT_BUFFER){
+            fwrite(text, 1, length, stdout);
+            return;
+        }
+    }
+    memcpy(Output + OutputUsed, text, length);
+    OutputUsed += length;
+}
+
+/*
+    function to add a string to Output
+*/
+void write_text(const char *text){
+    write_output(text, strlen(text));
+}
+
+/*
+    function to add a string to Output padded with spaces to width characters
+*/
+void write_padded(const char *text, int width){
+    static const char spaces[MAX_STRING + 1] = "                                        ";
+    int length = strlen(text);
+    write_output(text, length);
+    while(length < width){
+        int pad = width - length > MAX_STRING ? MAX_STRING : width - length;
+        write_output(spaces, pad);
+        length += pad;
+    }
+}
+
+/*
+    function to add a grade letter and a newline to Output
+*/
+void write_grade(char letter){
+    char text[2] = {letter, '\n'};
+    write_output(text, 2);
+}
+
+/*
+    function to print a student struct, field by field. The output
+    is gathered in Output, so callers must call flush_output
 */
-void print_student(student s, bool printOptions){
+void print_student(const student *s, bool printOptions){
+    char grades[3];
+
+    unpack_grade_chars(s->grades, grades);
 
     if(printOptions){
-        printf("A: Name: %s\n", s.name);
-        printf("B: Email: %s\n", s.email);
-        printf("C: UID: %s\n", s.id);
-        printf("D: Presentation Grade: %c\n", convert_grade_to_char(s.presentation));
-        printf("E: Essay Grade: %c\n", convert_grade_to_char(s.essay));
-        printf("F: Project Grade: %c\n", convert_grade_to_char(s.project));
-        printf("G: Exit Updating Student\n");
+        write_text("A: Name: ");
+        write_text(s->name);
+        write_text("\nB: Email: ");
+        write_text(s->email);
+        write_text("\nC: UID: ");
+        write_text(s->id);
+        write_text("\nD: Presentation Grade: ");
+        write_grade(grades[0]);
+        write_text("E: Essay Grade: ");
+        write_grade(grades[1]);
+        write_text("F: Project Grade: ");
+        write_grade(grades[2]);
+        write_text("G: Exit Updating Student\n");
     }
     else{
-        printf("Name: %s\n", s.name);
-        printf("Email: %s\n", s.email);
-        printf("UID: %s\n", s.id);
-        printf("Presentation Grade: %c\n", convert_grade_to_char(s.presentation));
-        printf("Essay Grade: %c\n", convert_grade_to_char(s.essay));
-        printf("Project Grade: %c\n", convert_grade_to_char(s.project));
+        write_text("Name: ");
+        write_text(s->name);
+        write_text("\nEmail: ");
+        write_text(s->email);
+        write_text("\nUID: ");
+        write_text(s->id);
+        write_text("\nPresentation Grade: ");
+        write_grade(grades[0]);
+        write_text("Essay Grade: ");
+        write_grade(grades[1]);
+        write_text("Project Grade: ");
+        write_grade(grades[2]);
     }
 
 }
@@ -226,6 +542,40 @@ bool id_check(char *str){
     return true;
 }
 
+/*
+    sets the field called key of student s to value
+    uses the same rules as the interactive prompts
+    returns an error message, or NULL if value was valid
+*/
+const char *set_student_field(student *s, const char *key, char *value){
+    trim_string(value);
+    if(strcmp(key, "name") == 0 || strcmp(key, "email") == 0){
+        if(strlen(value) == 0 || strlen(value) > MAX_STRING){
+            return "name and email must be 1 to 40 characters";
+        }
+        strcpy(key[0] == 'n' ? s->name : s->email, value);
+    } else if(strcmp(key, "uid") == 0){
+        if(strlen(value) == 0 || strlen(value) > MAX_ID || id_check(value) == false){
+            return "UID must be 1 to 10 digits";
+        }
+        strcpy(s->id, value);
+    } else if(strcmp(key, "presentation") == 0 || strcmp(key, "essay") == 0 || strcmp(key, "project") == 0){
+        if(strlen(value) != 1 || convert_char_to_grade(value[0]) == ERR){
+            return "grade must be one of A, B, C, D, F";
+        }
+        if(key[0] == 'p' && key[1] == 'r' && key[2] == 'e'){
+            s->grades = set_grade(s->grades, PRESENTATION, convert_char_to_grade(value[0]));
+        } else if(key[0] == 'e'){
+            s->grades = set_grade(s->grades, ESSAY, convert_char_to_grade(value[0]));
+        } else {
+            s->grades = set_grade(s->grades, PROJECT, convert_char_to_grade(value[0]));
+        }
+    } else {
+        return "unknown field";
+    }
+    return NULL;
+}
+
 /*
     prints all available commands for user
 */
@@ -235,497 +585,2979 @@ void print_commands(){
     printf("* a: Add Student         r: Remove Student *\n");
     printf("* p: Show Students       u: Update Student *\n");
     printf("* f: Find Student        q: Quit Program   *\n");
+    printf("* i: Import CSV          e: Export CSV     *\n");
+    printf("* s: Search Students     c: Ignore Case    *\n");
+    printf("* t: Table View          g: Grade Stats    *\n");
+    printf("* o: Sorted View         k: Rank Students  *\n");
     printf("********************************************\n");
     printf("Enter \"h\" for options menu\n");
 }
 
 /*
-    function to open save file for reading/writing
-    also ensures save file exists, creates one if not
+    function to open a temporary save file for rewriting
+    save_student_file renames it over ROSTER_FILE once complete
 */
-void open_student_file(FILE **file){
-    *file = fopen("students.txt", "r+");
+void write_student_file(FILE **file){
+    *file = fopen("students.tmp", "wb");
     if(*file == NULL){
-        printf("...students.txt does not exist. Creating new file\n");
-            *file = fopen("students.txt", "w");
-            if(*file == NULL){
-                printf("...Unable to open file\n");
-            return;
-            }
-        printf("...students.txt created successfully\n");
+        printf("Unable to open file..\n");
         return;
     }
 }
 
 /*
-    function to open save file for rewriting
+    function to map a save file into memory
+    returns NULL if it does not exist or is empty
 */
-void write_student_file(FILE **file){
-    *file = fopen("students.txt", "w+");
-    if(*file == NULL){
-        printf("Unable to open file..\n");
-        return;
+const char *map_file(const char *path, size_t *size){
+    char *data;
+#if defined(_WIN32)
+    FILE *file = fopen(path, "rb");
+    if(file == NULL){ return NULL; }
+    fseek(file, 0, SEEK_END);
+    *size = ftell(file);
+    rewind(file);
+    data = malloc(*size + 1);
+    if(data == NULL || fread(data, 1, *size, file) != *size){
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+#else
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    if(fd == -1){ return NULL; }
+    if(fstat(fd, &st) == -1 || st.st_size == 0){
+        close(fd);
+        return NULL;
     }
+    *size = st.st_size;
+    data = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED){ return NULL; }
+    madvise(data, *size, MADV_SEQUENTIAL);
+#endif
+    return data;
+}
+
+/*
+    function to release memory from map_file
+*/
+void unmap_file(const char *data, size_t size){
+#if defined(_WIN32)
+    free((char *)data);
+#else
+    munmap((char *)data, size);
+#endif
 }
 
 /*
     function to close the save file
+    returns false if anything written to it could not be flushed
 */
-void close_student_file(FILE **file){
-    fclose(*file);
+bool close_student_file(FILE **file){
+    bool ok = ferror(*file) == 0;
+    if(fclose(*file) != 0){
+        ok = false;
+    }
+    return ok;
 }
 
 /* ================================================================================================================== */
-/* MAIN FUNCTIONS */
+/* INDEX FUNCTIONS */
 
 /*
-    function to save the student file
+    FNV-1a hash of a null terminated string
 */
-void save_student_file(){
-    FILE *file;
-    int i;
-    char str[BUFFER];
+unsigned int hash_string(const char *str){
+    unsigned int h = 2166136261u;
+    while(*str != '\0'){
+        h ^= (unsigned char)*str;
+        h *= 16777619u;
+        str++;
+    }
+    return h;
+}
 
-    //open student file
-    write_student_file(&file);
+/*
+    returns the string of student s that field f indexes
+*/
+char *student_field(student_record *s, field f){
+    switch(f){
+        case FIELD_NAME:    return s->name;
+        case FIELD_EMAIL:   return s->email;
+        default:            return s->id;
+    }
+}
 
-    /* loops thru student array, adds all info to save file */
-    for (i = 0; i < count; i++){
-        //writes students name
-        strcpy(str, Students[i].name);
-        fprintf(file, "%s\n", str);
-        //writes students email
-        strcpy(str, Students[i].email);
-        fprintf(file, "%s\n", str);
-        //writes students uid
-        strcpy(str, Students[i].id);
-        fprintf(file, "%s\n", str);
-        //writes students presentation grade
-        fprintf(file, "%c\n", convert_grade_to_char(Students[i].presentation));
-        //writes students essay grade
-        fprintf(file, "%c\n", convert_grade_to_char(Students[i].essay));
-        //writes students project grade
-        fprintf(file, "%c\n", convert_grade_to_char(Students[i].project));
+/*
+    copies str into key folded to lower case
+*/
+void fold_key(char *key, const char *str){
+    while(*str != '\0'){
+        *key++ = tolower((unsigned char)*str++);
     }
+    *key = '\0';
+}
 
-    //close student file
-    close_student_file(&file);
+/*
+    returns the folded key of student s that indexes are built on
+*/
+char *index_key(student_record *s, field f){
+    switch(f){
+        case FIELD_NAME:    return s->nameKey;
+        case FIELD_EMAIL:   return s->emailKey;
+        default:            return s->id;
+    }
 }
 
 /*
-    function to load the student file
+    returns the string of student s that searches compare against,
+    the folded key if IgnoreCase is set
 */
-void load_student_file(){
-    FILE *file;
-    char str[BUFFER];
+char *match_text(student_record *s, field f){
+    return IgnoreCase ? index_key(s, f) : student_field(s, f);
+}
 
-    //open student file
-    open_student_file(&file);
-    if(fscanf(file, "%s", str) == EOF){
-        return;
-    } else {
-        rewind(file);
+/*
+    places student index i with key hash into hash table h without checking for space
+*/
+void index_place(hash_index *h, int i, unsigned int hash){
+    unsigned int mask = h->size - 1;
+    unsigned int pos = hash & mask;
+
+    //linear probe until an empty or deleted slot is found
+    while(h->slots[pos] >= 0){
+        pos = (pos + 1) & mask;
+    }
+    if(h->slots[pos] == EMPTY_SLOT){
+        h->used++;
     }
+    h->slots[pos] = i;
+    h->hashes[pos] = hash;
+    h->filled++;
+}
 
-    //read in file text
-    while(!feof(file)){
-        student s;
+/*
+    reallocates hash table h so it holds at least minimum students
+    at under half load, dropping all deleted slots
+*/
+void index_resize(hash_index *h, int minimum){
+    int *old = h->slots;
+    unsigned int *oldHashes = h->hashes;
+    int oldSize = h->size;
+    int size = INDEX_MIN_SIZE;
+
+    while(size < minimum * 2){
+        size *= 2;
+    }
 
-        //scan students name
-        fgets(str, BUFFER, file);
-        trim_string(str);
-        strcpy(s.name, str);
-
-        //scan students email
-        fgets(str, BUFFER, file);
-        trim_string(str);
-        strcpy(s.email, str);
-
-        //scan students id
-        fgets(str, BUFFER, file);
-        trim_string(str);
-        strcpy(s.id, str);
-
-        //scan students presentation grade
-        fgets(str, BUFFER, file);
-        trim_string(str);
-        s.presentation = convert_char_to_grade(str[0]);
-
-        //scan students presentation grade
-        fgets(str, BUFFER, file);
-        trim_string(str);
-        s.essay = convert_char_to_grade(str[0]);
-
-        //scan students presentation grade
-        fgets(str, BUFFER, file);
-        trim_string(str);
-        s.project = convert_char_to_grade(str[0]);
-
-        Students[count] = s;
-        count++;
-        add_student_memory();
+    h->slots = malloc(sizeof(int) * size);
+    h->hashes = malloc(sizeof(unsigned int) * size);
+    if(h->slots == NULL || h->hashes == NULL){
+        printf("...memory not allocated\n");
+        exit(1);
+    }
+    for(int j = 0; j < size; j++){
+        h->slots[j] = EMPTY_SLOT;
+    }
+    h->size = size;
+    h->filled = 0;
+    h->used = 0;
+
+    //move every student over from the old table
+    for(int j = 0; j < oldSize; j++){
+        if(old[j] >= 0){
+            index_place(h, old[j], oldHashes[j]);
+        }
+    }
+    free(old);
+    free(oldHashes);
+}
+
+/*
+    adds student index i to the index of field f
+*/
+void index_insert(field f, int i){
+    hash_index *h = &Indexes[f];
 
-        if(fscanf(file, "\n", str) == EOF) { break; }
+    //keep load (including deleted slots) under 3/4
+    if((h->used + 1) * 4 > h->size * 3){
+        index_resize(h, h->filled + 1);
     }
+    index_place(h, i, hash_string(index_key(student_at(i), f)));
+}
 
-    //close student file
-    close_student_file(&file);
-    return;
+/*
+    removes student index i from the index of field f
+    must be called before the student's field is changed
+*/
+void index_delete(field f, int i){
+    hash_index *h = &Indexes[f];
+    unsigned int mask = h->size - 1;
+    unsigned int hash, pos;
+
+    if(h->size == 0){ return; }
+    hash = hash_string(index_key(student_at(i), f));
+    pos = hash & mask;
+    while(h->slots[pos] != EMPTY_SLOT){
+        if(h->slots[pos] == i && h->hashes[pos] == hash){
+            h->slots[pos] = DELETED_SLOT;
+            h->filled--;
+            return;
+        }
+        pos = (pos + 1) & mask;
+    }
 }
 
-/* 
-    create and return new student
-    ADD FORMAT CHECKER FOR EMAIL AND ID
+/*
+    returns index of the first student (lowest index) whose field f equals key
+    ignores case of name and email if IgnoreCase is set
+    returns -1 if no student matches
 */
-student create_student(){
-    student s;
-    char input[BUFFER];
+int index_lookup(field f, const char *key){
+    hash_index *h = &Indexes[f];
+    unsigned int mask = h->size - 1;
+    unsigned int hash, pos;
+    char folded[MAX_STRING + 1];
+    int found = -1;
+
+    if(h->size == 0 || strlen(key) > MAX_STRING){ return -1; }
+
+    //indexes hold folded keys, so one probe serves both modes
+    fold_key(folded, key);
+    if(IgnoreCase){
+        key = folded;
+    }
+    hash = hash_string(folded);
+    pos = hash & mask;
+
+    //check the whole probe chain since names may repeat
+    while(h->slots[pos] != EMPTY_SLOT){
+        int i = h->slots[pos];
+        if(i >= 0 && h->hashes[pos] == hash && (found == -1 || i < found)
+           && strcmp(match_text(student_at(i), f), key) == 0){
+            found = i;
+            if(f == FIELD_UID){ break; }
+        }
+        pos = (pos + 1) & mask;
+    }
+    return found;
+}
 
-    //get name
-    printf("Enter student name (40 char max): ");
-    get_input(input);
-    while(strlen(input) == 0 || strlen(input) > MAX_STRING){
-        printf("Invalid name. Re-enter student name (40 char max): ");
-        get_input(input);
+/* ================================================================================================================== */
+/* SEARCH INDEX FUNCTIONS */
+
+/*
+    returns the mean of the grades in p, or -1 if it has none
+*/
+double student_gpa(packed_grades p){
+    int sum = 0, graded = 0;
+    for(int c = PRESENTATION; c <= PROJECT; c++){
+        grade g = get_grade(p, c);
+        if(g != ERR){
+            sum += g;
+            graded++;
+        }
     }
-    strcpy(s.name, input);
+    return graded > 0 ? (double)sum / graded : -1;
+}
 
-    //get email
-    printf("Enter student email: ");
-    get_input(input);
-    while(strlen(input) == 0 || strlen(input) > MAX_STRING){
-        printf("Invalid name. Re-enter student email (40 char max): ");
-        get_input(input);
+/*
+    orders two UIDs by numeric value, then as text so "007" and "7" differ
+*/
+int compare_uid(const char *a, const char *b){
+    unsigned long long x = strtoull(a, NULL, 10), y = strtoull(b, NULL, 10);
+    if(x != y){
+        return x < y ? -1 : 1;
     }
-    strcpy(s.email, input);
+    return strcmp(a, b);
+}
 
-    //get id
-    printf("Enter student UID: ");
-    get_input(input);
-    while(strlen(input) == 0 || strlen(input) > MAX_ID || id_check(input) == false){
-        printf("Invalid name. Re-enter student UID (10 char max): ");
-        get_input(input);
+/*
+    orders students a and b by field f, then by index
+    names and emails order by folded key, GPAs from lowest with ties by UID
+*/
+int compare_students(field f, int a, int b){
+    student_record *sa = student_at(a), *sb = student_at(b);
+    int order;
+
+    if(f == FIELD_GPA){
+        double x = student_gpa(*grades_at(a)), y = student_gpa(*grades_at(b));
+        order = x != y ? (x < y ? -1 : 1) : compare_uid(sa->id, sb->id);
+    } else if(f == FIELD_UID){
+        order = compare_uid(sa->id, sb->id);
+    } else {
+        order = strcmp(index_key(sa, f), index_key(sb, f));
     }
-    //check format
-    strcpy(s.id, input);
+    if(order != 0){
+        return order;
+    }
+    return (a > b) - (a < b);
+}
 
-    //get presentation grade
-    printf("Enter presentation grade (A, B, C, D, F): ");
-    get_input(input);
-    while(strlen(input) != 1 || convert_char_to_grade(input[0]) == ERR){
-        printf("Invalid grade. Re-enter presentation grade (A, B, C, D, F): ");
-        get_input(input);
+/*
+    returns a random skip list level, each level half as likely as the one below
+*/
+int random_level(){
+    int levels = 1;
+
+    //xorshift, keeps rand() free for anyone else
+    LevelSeed ^= LevelSeed << 13;
+    LevelSeed ^= LevelSeed >> 17;
+    LevelSeed ^= LevelSeed << 5;
+    while(levels < SKIP_LEVELS && (LevelSeed >> (levels - 1) & 1)){
+        levels++;
     }
-    s.presentation = convert_char_to_grade(input[0]);
+    return levels;
+}
 
-    //get essay grade
-    printf("Enter essay grade (A, B, C, D, F): ");
-    get_input(input);
-    while(strlen(input) != 1 || convert_char_to_grade(input[0]) == ERR){
-        printf("Invalid grade. Re-enter essay grade (A, B, C, D, F): ");
-        get_input(input);
+/*
+    allocates a skip list node for student index i
+*/
+skip_node *new_skip_node(int i, int levels){
+    skip_node *node = malloc(sizeof(skip_node) + sizeof(skip_node *) * levels);
+    if(node == NULL){
+        printf("...memory not allocated\n");
+        exit(1);
+    }
+    node->student = i;
+    node->levels = levels;
+    for(int l = 0; l < levels; l++){
+        node->next[l] = NULL;
     }
-    s.essay = convert_char_to_grade(input[0]);
+    return node;
+}
 
-    //get project grade
-    printf("Enter project grade (A, B, C, D, F): ");
-    get_input(input);
-    while(strlen(input) != 1 || convert_char_to_grade(input[0]) == ERR){
-        printf("Invalid grade. Re-enter project grade (A, B, C, D, F): ");
-        get_input(input);
+/*
+    frees all nodes of a skip list and marks it unbuilt
+*/
+void skip_free(skip_list *list){
+    skip_node *node = list->head;
+    while(node != NULL){
+        skip_node *next = node->next[0];
+        free(node);
+        node = next;
     }
-    s.project = convert_char_to_grade(input[0]);
-    return s;
+    list->head = NULL;
+    list->levels = 0;
+    list->built = false;
 }
 
 /*
-    function to search for student***
-    RETURN POINTER OR INDEX
+    finds the last node on each level that orders before student index i
 */
-int find_student(){
-    char input[BUFFER];
-    int parameter, valid = 0;
+void skip_find(skip_list *list, field f, int i, skip_node **update){
+    skip_node *node = list->head;
+    for(int l = list->levels - 1; l >= 0; l--){
+        while(node->next[l] != NULL && compare_students(f, node->next[l]->student, i) < 0){
+            node = node->next[l];
+        }
+        update[l] = node;
+    }
+}
 
-    //get search parameter
-    printf("A: Name\nB: Email\nC: UID\nD: Exit\n");
-    printf("How would you like to search for the student?\n");
-    while(valid == 0){
-        printf("Enter letter of search parameter: ");
-        get_input(input);
-        if(strlen(input) == 1){
-            switch(input[0]){
-                case 'A': case 'a':
-                    parameter = 0;
-                    valid = 1;
-                    break;
-                case 'B': case 'b':
-                    parameter = 1;
-                    valid = 1;
-                    break;
-                case 'C': case 'c':
-                    parameter = 2;
+/*
+    adds student index i to the skip list of field f, if it is built
+*/
+void skip_insert(field f, int i){
+    skip_list *list = &Ordered[f];
+    skip_node *update[SKIP_LEVELS], *node;
+    int levels = random_level();
+
+    if(!list->built){ return; }
+    skip_find(list, f, i, update);
+    for(int l = list->levels; l < levels; l++){
+        update[l] = list->head;
+    }
+    if(levels > list->levels){
+        list->levels = levels;
+    }
+
+    node = new_skip_node(i, levels);
+    for(int l = 0; l < levels; l++){
+        node->next[l] = update[l]->next[l];
+        update[l]->next[l] = node;
+    }
+}
+
+/*
+    removes student index i from the skip list of field f, if it is built
+    must be called before the student's field is changed
+*/
+void skip_delete(field f, int i){
+    skip_list *list = &Ordered[f];
+    skip_node *update[SKIP_LEVELS], *node;
+
+    if(!list->built){ return; }
+    skip_find(list, f, i, update);
+    node = update[0]->next[0];
+    if(node == NULL || node->student != i){
+        return;
+    }
+    for(int l = 0; l < node->levels; l++){
+        update[l]->next[l] = node->next[l];
+    }
+    free(node);
+    while(list->levels > 1 && list->head->next[list->levels - 1] == NULL){
+        list->levels--;
+    }
+}
+
+field SortField;                            //field compared by compare_sort
+
+/*
+    qsort comparison of two student indexes by SortField
+*/
+int compare_sort(const void *a, const void *b){
+    return compare_students(SortField, *(const int *)a, *(const int *)b);
+}
+
+/*
+    builds the skip list of field f from all students in one sorted pass
+*/
+void skip_build(field f){
+    skip_list *list = &Ordered[f];
+    skip_node *last[SKIP_LEVELS];
+    int *order = malloc(sizeof(int) * (count + 1));
+    int n = 0;
+
+    if(order == NULL){
+        printf("...memory not allocated\n");
+        exit(1);
+    }
+    for(int i = First; i != -1; i = student_at(i)->next){
+        order[n++] = i;
+    }
+    SortField = f;
+    qsort(order, n, sizeof(int), compare_sort);
+
+    //link sorted students left to right, remembering the last node on each level
+    skip_free(list);
+    list->head = new_skip_node(-1, SKIP_LEVELS);
+    list->levels = 1;
+    for(int l = 0; l < SKIP_LEVELS; l++){
+        last[l] = list->head;
+    }
+    for(int j = 0; j < n; j++){
+        int levels = random_level();
+        skip_node *node = new_skip_node(order[j], levels);
+        for(int l = 0; l < levels; l++){
+            last[l]->next[l] = node;
+            last[l] = node;
+        }
+        if(levels > list->levels){
+            list->levels = levels;
+        }
+    }
+    list->built = true;
+    free(order);
+}
+
+/*
+    appends student index i to a growing result array
+*/
+void add_result(int **results, int *n, int *max, int i){
+    if(*n == *max){
+        *max = *max == 0 ? 64 : *max * 2;
+        *results = realloc(*results, sizeof(int) * *max);
+        if(*results == NULL){
+            printf("...memory not allocated\n");
+            exit(1);
+        }
+    }
+    (*results)[(*n)++] = i;
+}
+
+/*
+    finds every student whose field f starts with prefix, in sorted order
+    sets results to a malloc'd array of student indexes, returns its length
+*/
+int search_prefix(field f, const char *prefix, int **results){
+    skip_list *list = &Ordered[f];
+    skip_node *node;
+    size_t length = strlen(prefix);
+    char folded[MAX_STRING + 1];
+    int n = 0, max = 0;
+
+    *results = NULL;
+    if(length > MAX_STRING){
+        return 0;
+    }
+    if(!list->built){
+        skip_build(f);
+    }
+    fold_key(folded, prefix);
+
+    //walk down to the last node before the folded prefix
+    node = list->head;
+    for(int l = list->levels - 1; l >= 0; l--){
+        while(node->next[l] != NULL && strcmp(index_key(student_at(node->next[l]->student), f), folded) < 0){
+            node = node->next[l];
+        }
+    }
+
+    //every following node that starts with the folded prefix matches,
+    //unless case matters and the original text differs
+    for(node = node->next[0]; node != NULL; node = node->next[0]){
+        student_record *s = student_at(node->student);
+        if(strncmp(index_key(s, f), folded, length) != 0){
+            break;
+        }
+        if(IgnoreCase || strncmp(student_field(s, f), prefix, length) == 0){
+            add_result(results, &n, &max, node->student);
+        }
+    }
+    return n;
+}
+
+/*
+    returns the order of student index i against bound on field f, as strcmp does
+    names and emails compare only as many characters as bound has,
+    so a bound matches every key it is a prefix of
+*/
+int compare_bound(field f, int i, const char *bound){
+    student_record *s = student_at(i);
+    switch(f){
+        case FIELD_UID:{
+            unsigned long long x = strtoull(s->id, NULL, 10), y = strtoull(bound, NULL, 10);
+            return (x > y) - (x < y);
+        }
+        case FIELD_GPA:{
+            double x = student_gpa(*grades_at(i)), y = atof(bound);
+            return (x > y) - (x < y);
+        }
+        default:
+            return strncmp(index_key(s, f), bound, strlen(bound));
+    }
+}
+
+/*
+    checks that bound is a valid end of a range over field f
+    returns an error message, or NULL if it is valid
+*/
+const char *check_bound(field f, const char *bound){
+    char *end;
+    switch(f){
+        case FIELD_UID:
+            if(strlen(bound) == 0 || strlen(bound) > MAX_ID || id_check((char *)bound) == false){
+                return "UID must be 1 to 10 digits";
+            }
+            return NULL;
+        case FIELD_GPA:{
+            double gpa = strtod(bound, &end);
+            if(end == bound || *end != '\0' || gpa < 0 || gpa > A){
+                return "GPA must be a number from 0 to 4";
+            }
+            return NULL;
+        }
+        default:
+            if(strlen(bound) == 0 || strlen(bound) > MAX_STRING){
+                return "name and email must be 1 to 40 characters";
+            }
+            return NULL;
+    }
+}
+
+/*
+    finds every student whose field f lies between low and high, in sorted order
+    either bound may be NULL to leave that end open, so both NULL lists everyone
+    sets results to a malloc'd array of student indexes, returns its length
+*/
+int search_range(field f, const char *low, const char *high, int **results){
+    skip_list *list = &Ordered[f];
+    skip_node *node;
+    char lowKey[MAX_STRING + 1], highKey[MAX_STRING + 1];
+    int n = 0, max = 0;
+
+    *results = NULL;
+    if((low != NULL && strlen(low) > MAX_STRING) || (high != NULL && strlen(high) > MAX_STRING)){
+        return 0;
+    }
+    if(!list->built){
+        skip_build(f);
+    }
+    if(low != NULL){ fold_key(lowKey, low); }
+    if(high != NULL){ fold_key(highKey, high); }
+
+    //walk down to the last node before the low bound
+    node = list->head;
+    if(low != NULL){
+        for(int l = list->levels - 1; l >= 0; l--){
+            while(node->next[l] != NULL && compare_bound(f, node->next[l]->student, lowKey) < 0){
+                node = node->next[l];
+            }
+        }
+    }
+
+    //every following node up to the high bound is in range
+    for(node = node->next[0]; node != NULL; node = node->next[0]){
+        if(high != NULL && compare_bound(f, node->student, highKey) > 0){
+            break;
+        }
+        add_result(results, &n, &max, node->student);
+    }
+    return n;
+}
+
+/*
+    returns posting list of the trigram starting at str
+*/
+unsigned int trigram_bucket(const char *str){
+    unsigned int t = (unsigned char)str[0] << 16 | (unsigned char)str[1] << 8 | (unsigned char)str[2];
+    return (t * 2654435761u) >> 16 & (TRIGRAM_BUCKETS - 1);
+}
+
+/*
+    adds student index i to the posting list of every folded trigram of field f, if built
+*/
+void trigram_insert(field f, int i){
+    trigram_index *t = &Trigrams[f];
+    const char *str = index_key(student_at(i), f);
+
+    if(!t->built){ return; }
+    for(size_t j = 0; j + 3 <= strlen(str); j++){
+        unsigned int b = trigram_bucket(str + j);
+
+        //a string may repeat a trigram, list it once
+        if(t->lengths[b] > 0 && t->lists[b][t->lengths[b] - 1] == i){
+            continue;
+        }
+        if(t->lengths[b] == t->sizes[b]){
+            t->sizes[b] = t->sizes[b] == 0 ? 4 : t->sizes[b] * 2;
+            t->lists[b] = realloc(t->lists[b], sizeof(int) * t->sizes[b]);
+            if(t->lists[b] == NULL){
+                printf("...memory not allocated\n");
+                exit(1);
+            }
+        }
+        t->lists[b][t->lengths[b]++] = i;
+        t->postings++;
+    }
+}
+
+/*
+    frees a trigram index and marks it unbuilt
+*/
+void trigram_free(trigram_index *t){
+    if(t->lists != NULL){
+        for(int b = 0; b < TRIGRAM_BUCKETS; b++){
+            free(t->lists[b]);
+        }
+    }
+    free(t->lists);
+    free(t->lengths);
+    free(t->sizes);
+    t->lists = NULL;
+    t->lengths = NULL;
+    t->sizes = NULL;
+    t->postings = 0;
+    t->stale = 0;
+    t->built = false;
+}
+
+/*
+    notes that the trigram entries of student index i in field f are stale
+    once most entries are stale the index is dropped and rebuilt on next use
+*/
+void trigram_forget(field f, int i){
+    trigram_index *t = &Trigrams[f];
+    size_t length = strlen(student_field(student_at(i), f));
+
+    if(!t->built){ return; }
+    t->stale += length < 3 ? 0 : length - 2;
+    if(t->stale > t->postings / 2 && t->stale > TRIGRAM_BUCKETS){
+        trigram_free(t);
+    }
+}
+
+/*
+    builds the trigram index of field f from all students
+*/
+void trigram_build(field f){
+    trigram_index *t = &Trigrams[f];
+
+    trigram_free(t);
+    t->lists = calloc(TRIGRAM_BUCKETS, sizeof(int *));
+    t->lengths = calloc(TRIGRAM_BUCKETS, sizeof(int));
+    t->sizes = calloc(TRIGRAM_BUCKETS, sizeof(int));
+    if(t->lists == NULL || t->lengths == NULL || t->sizes == NULL){
+        printf("...memory not allocated\n");
+        exit(1);
+    }
+    t->built = true;
+    for(int i = First; i != -1; i = student_at(i)->next){
+        trigram_insert(f, i);
+    }
+}
+
+/*
+    qsort comparison of two student indexes by index
+*/
+int compare_index(const void *a, const void *b){
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+    finds every student whose field f contains needle
+    sets results to a malloc'd array of student indexes, returns its length
+*/
+int search_substring(field f, const char *needle, int **results){
+    trigram_index *t = &Trigrams[f];
+    size_t length = strlen(needle);
+    char folded[MAX_STRING + 1];
+    int n = 0, max = 0, unique = 0;
+    int *list = NULL, listLength = 0;
+
+    *results = NULL;
+    if(length > MAX_STRING){
+        return 0;
+    }
+    fold_key(folded, needle);
+    if(IgnoreCase){
+        needle = folded;
+    }
+
+    //needles shorter than a trigram check every student
+    if(length < 3){
+        for(int i = First; i != -1; i = student_at(i)->next){
+            if(strstr(match_text(student_at(i), f), needle) != NULL){
+                add_result(results, &n, &max, i);
+            }
+        }
+        return n;
+    }
+
+    if(!t->built){
+        trigram_build(f);
+    }
+
+    //only students in the shortest posting list of the needle can match
+    for(size_t j = 0; j + 3 <= length; j++){
+        unsigned int b = trigram_bucket(folded + j);
+        if(list == NULL || t->lengths[b] < listLength){
+            list = t->lists[b];
+            listLength = t->lengths[b];
+        }
+    }
+    for(int k = 0; k < listLength; k++){
+        int i = list[k];
+        if(i < slotCount && !student_at(i)->removed && strstr(match_text(student_at(i), f), needle) != NULL){
+            add_result(results, &n, &max, i);
+        }
+    }
+
+    //stale entries may list a reused student twice
+    qsort(*results, n, sizeof(int), compare_index);
+    for(int k = 0; k < n; k++){
+        if(k == 0 || (*results)[k] != (*results)[k - 1]){
+            (*results)[unique++] = (*results)[k];
+        }
+    }
+    return unique;
+}
+
+/* ================================================================================================================== */
+/* ROSTER FUNCTIONS */
+
+/*
+    adds all fields of student index i to the indexes
+*/
+void index_add_student(int i){
+    index_insert(FIELD_NAME, i);
+    index_insert(FIELD_EMAIL, i);
+    index_insert(FIELD_UID, i);
+    for(int f = FIELD_NAME; f <= FIELD_GPA; f++){
+        skip_insert(f, i);
+    }
+    for(int f = FIELD_NAME; f <= FIELD_EMAIL; f++){
+        trigram_insert(f, i);
+    }
+}
+
+/*
+    removes all fields of student index i from the indexes
+*/
+void index_remove_student(int i){
+    index_delete(FIELD_NAME, i);
+    index_delete(FIELD_EMAIL, i);
+    index_delete(FIELD_UID, i);
+    for(int f = FIELD_NAME; f <= FIELD_GPA; f++){
+        skip_delete(f, i);
+    }
+    for(int f = FIELD_NAME; f <= FIELD_EMAIL; f++){
+        trigram_forget(f, i);
+    }
+}
+
+/*
+    frees all indexes
+*/
+void free_indexes(){
+    for(int f = FIELD_NAME; f <= FIELD_UID; f++){
+        free(Indexes[f].slots);
+        free(Indexes[f].hashes);
+        Indexes[f].slots = NULL;
+        Indexes[f].hashes = NULL;
+        Indexes[f].size = 0;
+        Indexes[f].filled = 0;
+        Indexes[f].used = 0;
+    }
+
+    //search indexes are rebuilt on next search or sorted listing
+    for(int f = FIELD_NAME; f <= FIELD_GPA; f++){
+        skip_free(&Ordered[f]);
+    }
+    for(int f = FIELD_NAME; f <= FIELD_EMAIL; f++){
+        trigram_free(&Trigrams[f]);
+    }
+}
+
+/*
+    rebuilds all indexes from Students
+*/
+void build_indexes(){
+    free_indexes();
+    for(int f = FIELD_NAME; f <= FIELD_UID; f++){
+        index_resize(&Indexes[f], count);
+        for(int i = First; i != -1; i = student_at(i)->next){
+            index_place(&Indexes[f], i, hash_string(index_key(student_at(i), f)));
+        }
+    }
+}
+
+/*
+    stores the strings of student s in record r and its grades in slot i of Grades
+    names and emails are folded to keys once here rather than on every comparison
+*/
+void store_student(int i, student_record *r, const student *s){
+    strcpy(r->name, s->name);
+    strcpy(r->email, s->email);
+    strcpy(r->id, s->id);
+    fold_key(r->nameKey, s->name);
+    fold_key(r->emailKey, s->email);
+    *grades_at(i) = s->grades;
+}
+
+/*
+    returns a copy of student index i, its strings joined with its grades
+*/
+student copy_student(int i){
+    student_record *r = student_at(i);
+    student s;
+
+    strcpy(s.name, r->name);
+    strcpy(s.email, r->email);
+    strcpy(s.id, r->id);
+    s.grades = *grades_at(i);
+    return s;
+}
+
+/*
+    adds student s to the end of the listing and to the indexes
+    reuses a removed slot if there is one
+    returns index of the new student
+*/
+int append_student(student s){
+    student_record *r;
+    int i;
+
+    //take slot from free list, or a new one at the end
+    if(FreeSlot != -1){
+        i = FreeSlot;
+        FreeSlot = student_at(i)->next;
+    } else {
+        add_student_memory();
+        i = slotCount;
+        slotCount++;
+    }
+
+    //link at end of listing order
+    r = student_at(i);
+    store_student(i, r, &s);
+    r->prev = Last;
+    r->next = -1;
+    r->removed = false;
+    if(Last != -1){
+        student_at(Last)->next = i;
+    } else {
+        First = i;
+    }
+    Last = i;
+
+    index_add_student(i);
+    count++;
+    return i;
+}
+
+/*
+    replaces student index i with s and re-indexes it
+*/
+void replace_student(int i, student s){
+    index_remove_student(i);
+    store_student(i, student_at(i), &s);
+    index_add_student(i);
+}
+
+/*
+    removes student index i from the listing and the indexes in constant time
+    slot is left as a tombstone on the free list until reused or compacted
+*/
+void delete_student(int i){
+    student_record *s = student_at(i);
+
+    index_remove_student(i);
+
+    //unlink from listing order
+    if(s->prev != -1){
+        student_at(s->prev)->next = s->next;
+    } else {
+        First = s->next;
+    }
+    if(s->next != -1){
+        student_at(s->next)->prev = s->prev;
+    } else {
+        Last = s->prev;
+    }
+
+    //push onto free list, with no grades for grade scans to count
+    s->removed = true;
+    *grades_at(i) = pack_grades(ERR, ERR, ERR);
+    s->prev = -1;
+    s->next = FreeSlot;
+    FreeSlot = i;
+    count--;
+}
+
+/*
+    moves all students into new segments in listing order, dropping tombstones
+    runs once removed slots pass CompactRatio of all slots
+*/
+void compact_students(){
+    student_record **old = Students;
+    packed_grades **oldGrades = Grades;
+    int oldSegments = segments;
+    int i = First, removed = slotCount - count;
+
+    if(removed == 0 || removed < CompactRatio * slotCount){
+        return;
+    }
+
+    Students = NULL;
+    Grades = NULL;
+    segments = 0;
+    maxSegments = 0;
+    slotCount = 0;
+    First = Last = FreeSlot = -1;
+    count = 0;
+
+    //copy live students in listing order, so listing order is unchanged
+    while(i != -1){
+        student_record *s = &old[i >> SEGMENT_SHIFT][i & (SEGMENT_SIZE - 1)];
+        add_student_memory();
+        *student_at(slotCount) = *s;
+        *grades_at(slotCount) = oldGrades[i >> SEGMENT_SHIFT][i & (SEGMENT_SIZE - 1)];
+        i = s->next;
+        student_at(slotCount)->prev = slotCount - 1;
+        student_at(slotCount)->next = -1;
+        if(slotCount > 0){
+            student_at(slotCount - 1)->next = slotCount;
+        }
+        slotCount++;
+    }
+    count = slotCount;
+    if(count > 0){
+        First = 0;
+        Last = count - 1;
+    }
+
+    for(int j = 0; j < oldSegments; j++){
+        free(old[j]);
+        free(oldGrades[j]);
+    }
+    free(old);
+    free(oldGrades);
+
+    //every student moved, so index again
+    build_indexes();
+}
+
+/* ================================================================================================================== */
+/* MAIN FUNCTIONS */
+
+/*
+    function to save the student file
+    returns false, leaving ROSTER_FILE as it was, if it could not be fully written
+*/
+bool save_student_file(){
+    FILE *file;
+    int i;
+    bool ok = true;
+    roster_header header;
+    roster_record record;
+
+    //open student file
+    write_student_file(&file);
+    if(file == NULL){
+        return false;
+    }
+
+    //writes header
+    memcpy(header.magic, ROSTER_MAGIC, 4);
+    header.version = ROSTER_VERSION;
+    header.count = count;
+    header.recordSize = sizeof(roster_record);
+    if(fwrite(&header, sizeof(header), 1, file) != 1){
+        ok = false;
+    }
+
+    /* loops thru student array, adds one fixed size record per student */
+    for (i = First; i != -1 && ok; i = student_at(i)->next){
+        student_record *s = student_at(i);
+        packed_grades grades = *grades_at(i);
+        memset(&record, 0, sizeof(record));
+        strcpy(record.name, s->name);
+        strcpy(record.email, s->email);
+        strcpy(record.id, s->id);
+        record.grades[0] = (uint8_t)(grades & 0xff);
+        record.grades[1] = (uint8_t)(grades >> 8);
+        if(fwrite(&record, sizeof(record), 1, file) != 1){
+            ok = false;
+        }
+    }
+
+    //close student file
+    if(!close_student_file(&file)){
+        ok = false;
+    }
+    if(!ok){
+        printf("...Unable to write save file, %s was not changed\n", ROSTER_FILE);
+        remove("students.tmp");
+        return false;
+    }
+
+    //replace old save file only once the new one is fully written
+#if defined(_WIN32)
+    remove(ROSTER_FILE);
+#endif
+    if(rename("students.tmp", ROSTER_FILE) != 0){
+        printf("...Unable to replace %s\n", ROSTER_FILE);
+        return false;
+    }
+    return true;
+}
+
+/*
+    function to open the journal for appending
+*/
+void open_journal(){
+    Journal = fopen(JOURNAL_FILE, "a");
+    if(Journal == NULL){
+        printf("...Unable to open journal\n");
+        return;
+    }
+    fseek(Journal, 0, SEEK_END);
+    JournalBytes = ftell(Journal);
+}
+
+/*
+    function to rewrite the save file from memory and empty the journal
+    the journal is kept if the save file could not be written
+*/
+void compact_student_file(){
+    if(!save_student_file()){
+        return;
+    }
+    if(Journal != NULL){
+        fclose(Journal);
+    }
+    Journal = fopen(JOURNAL_FILE, "w");
+    JournalBytes = 0;
+}
+
+/*
+    function to append a change to the journal
+    op is 'A' (add), 'U' (update) or 'R' (remove)
+    oldId is the UID the student had before an update or remove
+*/
+void journal_write(char op, const char *oldId, student *s){
+    char grades[3] = {'?', '?', '?'};
+    int written;
+
+    if(Journal == NULL){
+        save_student_file();
+        return;
+    }
+
+    if(s != NULL){
+        unpack_grade_chars(s->grades, grades);
+    }
+    switch(op){
+        case 'A':
+            written = fprintf(Journal, "A\t%s\t%s\t%s\t%c\t%c\t%c\n", s->name, s->email, s->id,
+                              grades[0], grades[1], grades[2]);
+            break;
+        case 'U':
+            written = fprintf(Journal, "U\t%s\t%s\t%s\t%s\t%c\t%c\t%c\n", oldId, s->name, s->email, s->id,
+                              grades[0], grades[1], grades[2]);
+            break;
+        default:
+            written = fprintf(Journal, "R\t%s\n", oldId);
+            break;
+    }
+    fflush(Journal);
+    JournalBytes += written;
+
+    //fold journal into a fresh save file once it grows too large
+    if(JournalBytes > JOURNAL_MAX_BYTES){
+        compact_student_file();
+    }
+}
+
+/*
+    function to cut the journal back to its first length bytes
+*/
+void truncate_journal(long length){
+#if defined(_WIN32)
+    FILE *file = fopen(JOURNAL_FILE, "r+b");
+    if(file == NULL || _chsize(_fileno(file), length) != 0){
+        printf("...Unable to truncate journal\n");
+    }
+    if(file != NULL){
+        fclose(file);
+    }
+#else
+    if(truncate(JOURNAL_FILE, length) != 0){
+        printf("...Unable to truncate journal\n");
+    }
+#endif
+}
+
+/*
+    function to re-apply the changes saved in the journal
+    called after the save file is loaded
+    a partially written last line is cut off so later changes start on a line of their own
+*/
+void replay_journal(){
+    FILE *file;
+    char str[BUFFER];
+    long complete = 0;                      //bytes of journal in complete lines
+
+    file = fopen(JOURNAL_FILE, "rb");
+    if(file == NULL){
+        return;
+    }
+
+    while(fgets(str, BUFFER, file) != NULL){
+        char *fields[8];
+        int n = 0, i;
+        student s;
+
+        //stop at a partially written last line
+        if(strchr(str, '\n') == NULL){
+            break;
+        }
+        complete = ftell(file);
+        str[strcspn(str, "\r\n")] = '\0';
+
+        //split line into tab separated fields
+        fields[n++] = str;
+        for(char *ptr = str; *ptr != '\0' && n < 8; ptr++){
+            if(*ptr == '\t'){
+                *ptr = '\0';
+                fields[n++] = ptr + 1;
+            }
+        }
+
+        switch(str[0]){
+            case 'A': case 'U':
+                if(n != (str[0] == 'A' ? 7 : 8)){ break; }
+                n = (str[0] == 'A' ? 1 : 2);
+                strcpy(s.name, fields[n]);
+                strcpy(s.email, fields[n + 1]);
+                strcpy(s.id, fields[n + 2]);
+                s.grades = pack_grade_chars(fields[n + 3][0], fields[n + 4][0], fields[n + 5][0]);
+
+                //an add for an existing UID replaces it so replaying twice is harmless
+                i = index_lookup(FIELD_UID, fields[str[0] == 'A' ? 3 : 1]);
+                if(i != -1){
+                    replace_student(i, s);
+                } else if(str[0] == 'A'){
+                    append_student(s);
+                }
+                break;
+            case 'R':
+                if(n != 2){ break; }
+                i = index_lookup(FIELD_UID, fields[1]);
+                if(i != -1){
+                    delete_student(i);
+                }
+                break;
+        }
+    }
+
+    //anything past the last newline was torn by a crash, drop it before appending again
+    fseek(file, 0, SEEK_END);
+    if(ftell(file) > complete){
+        printf("...Dropping partially written journal entry\n");
+        fclose(file);
+        truncate_journal(complete);
+        return;
+    }
+    fclose(file);
+}
+
+/*
+    function to load the binary save file
+    returns false if it does not exist or is not a valid save file
+*/
+bool load_roster_file(){
+    size_t size;
+    const char *data = map_file(ROSTER_FILE, &size);
+    roster_header header;
+
+    if(data == NULL){
+        return false;
+    }
+
+    //check header before trusting any records
+    if(size < sizeof(header)){
+        unmap_file(data, size);
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if(memcmp(header.magic, ROSTER_MAGIC, 4) != 0
+       || !((header.version == ROSTER_VERSION && header.recordSize == sizeof(roster_record))
+            || (header.version == 1 && header.recordSize == sizeof(roster_record_v1)))
+       || (size - sizeof(header)) / header.recordSize < header.count){
+        printf("...%s is not a valid save file\n", ROSTER_FILE);
+        unmap_file(data, size);
+        return false;
+    }
+
+    //copy records straight into Students, no parsing needed
+    for(uint32_t i = 0; i < header.count; i++){
+        const roster_record *record = (const roster_record *)(data + sizeof(header) + (size_t)i * header.recordSize);
+        student s;
+        memcpy(s.name, record->name, sizeof(s.name));
+        memcpy(s.email, record->email, sizeof(s.email));
+        memcpy(s.id, record->id, sizeof(s.id));
+        s.name[MAX_STRING] = s.email[MAX_STRING] = s.id[MAX_ID] = '\0';
+        if(header.version == 1){
+            const roster_record_v1 *old = (const roster_record_v1 *)record;
+            s.grades = pack_grades(old->presentation <= A ? old->presentation : ERR,
+                                   old->essay <= A ? old->essay : ERR,
+                                   old->project <= A ? old->project : ERR);
+        } else {
+            s.grades = (packed_grades)(record->grades[0] | record->grades[1] << 8);
+            for(component c = PRESENTATION; c <= PROJECT; c++){
+                if(get_grade(s.grades, c) > A){
+                    s.grades = set_grade(s.grades, c, ERR);
+                }
+            }
+        }
+        append_student(s);
+    }
+
+    unmap_file(data, size);
+    return true;
+}
+
+/*
+    finds the next line between ptr and end that is not blank
+    sets line and lineEnd to its first and one past its last character
+    returns pointer to the start of the following line, or NULL if there is none
+*/
+const char *next_text_line(const char *ptr, const char *end, const char **line, const char **lineEnd){
+    while(ptr < end){
+        const char *newline = memchr(ptr, '\n', end - ptr);
+        const char *stop = newline == NULL ? end : newline;
+        const char *next = newline == NULL ? end : newline + 1;
+
+        for(const char *c = ptr; c < stop; c++){
+            if(!isspace((unsigned char)*c)){
+                *line = ptr;
+                *lineEnd = stop;
+                return next;
+            }
+        }
+        ptr = next;
+    }
+    return NULL;
+}
+
+/*
+    copies a line into dst of max characters
+    trims it the same way as trim_string
+*/
+void copy_text_field(char *dst, int max, const char *line, const char *lineEnd){
+    int n = 0;
+
+    while(line < lineEnd && isspace((unsigned char)*line)){ line++; }
+    while(lineEnd > line && isspace((unsigned char)lineEnd[-1])){ lineEnd--; }
+    while(line < lineEnd && n < max){
+        dst[n++] = *line == '\t' ? ' ' : *line;
+        line++;
+    }
+    dst[n] = '\0';
+}
+
+/*
+    thread function counting the non-blank lines of a chunk
+*/
+void *count_chunk_lines(void *arg){
+    load_chunk *chunk = arg;
+    const char *ptr = chunk->start, *line, *lineEnd;
+
+    chunk->lines = 0;
+    while((ptr = next_text_line(ptr, chunk->end, &line, &lineEnd)) != NULL){
+        chunk->lines++;
+    }
+    return NULL;
+}
+
+/*
+    thread function parsing the students whose first line lies in a chunk
+    every student is six non-blank lines, chunk->lines holds the number of
+    non-blank lines in the file before the chunk
+*/
+void *parse_chunk(void *arg){
+    load_chunk *chunk = arg;
+    const char *ptr = chunk->start, *line, *lineEnd;
+    const char *lines[6][2];
+
+    //skip lines that belong to a student started in an earlier chunk
+    for(long skip = (6 - chunk->lines % 6) % 6; skip > 0 && ptr != NULL; skip--){
+        ptr = next_text_line(ptr, chunk->end, &line, &lineEnd);
+    }
+
+    while(ptr != NULL && ptr < chunk->end){
+        student s;
+        int n;
+
+        //gather six lines, the last ones may lie in the next chunk
+        for(n = 0; n < 6 && ptr != NULL; n++){
+            ptr = next_text_line(ptr, n == 0 ? chunk->end : chunk->fileEnd, &lines[n][0], &lines[n][1]);
+        }
+        if(n < 6){
+            break;
+        }
+
+        copy_text_field(s.name, MAX_STRING, lines[0][0], lines[0][1]);
+        copy_text_field(s.email, MAX_STRING, lines[1][0], lines[1][1]);
+        copy_text_field(s.id, MAX_ID, lines[2][0], lines[2][1]);
+        while(isspace((unsigned char)*lines[3][0])){ lines[3][0]++; }
+        while(isspace((unsigned char)*lines[4][0])){ lines[4][0]++; }
+        while(isspace((unsigned char)*lines[5][0])){ lines[5][0]++; }
+        s.grades = pack_grade_chars(*lines[3][0], *lines[4][0], *lines[5][0]);
+
+        if(chunk->count == chunk->max){
+            chunk->max = chunk->max == 0 ? SEGMENT_SIZE : chunk->max * 2;
+            chunk->students = realloc(chunk->students, sizeof(student) * chunk->max);
+            if(chunk->students == NULL){
+                printf("...memory not allocated\n");
+                exit(1);
+            }
+        }
+        chunk->students[chunk->count++] = s;
+    }
+    return NULL;
+}
+
+/*
+    runs func on every chunk, one thread each
+*/
+void run_chunks(void *(*func)(void *), load_chunk *chunks, int n){
+#if defined(_WIN32)
+    for(int c = 0; c < n; c++){
+        func(&chunks[c]);
+    }
+#else
+    pthread_t threads[LOAD_MAX_THREADS];
+
+    for(int c = 1; c < n; c++){
+        if(pthread_create(&threads[c], NULL, func, &chunks[c]) != 0){
+            func(&chunks[c]);
+            threads[c] = pthread_self();
+        }
+    }
+    func(&chunks[0]);
+    for(int c = 1; c < n; c++){
+        if(!pthread_equal(threads[c], pthread_self())){
+            pthread_join(threads[c], NULL);
+        }
+    }
+#endif
+}
+
+/*
+    function to import the legacy six line text save file
+    the file is split into chunks at line boundaries and parsed by
+    several threads, then students are added in file order
+*/
+void load_text_file(){
+    size_t size;
+    const char *data = map_file(TEXT_FILE, &size);
+    load_chunk chunks[LOAD_MAX_THREADS];
+    int threads = 1;
+    long lines = 0;
+
+    if(data == NULL){
+        printf("...%s does not exist. Starting new roster\n", ROSTER_FILE);
+        return;
+    }
+    printf("...importing %s\n", TEXT_FILE);
+
+    //one thread per LOAD_MIN_BYTES, up to one per core
+#if !defined(_WIN32)
+    threads = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if(threads > LOAD_MAX_THREADS){ threads = LOAD_MAX_THREADS; }
+    if((size_t)threads > size / LOAD_MIN_BYTES){ threads = size / LOAD_MIN_BYTES; }
+    if(threads < 1){ threads = 1; }
+
+    //split file into chunks that each start at the beginning of a line
+    for(int c = 0; c < threads; c++){
+        const char *start = c == 0 ? data : chunks[c - 1].end;
+        const char *end = data + size * (c + 1) / threads;
+        if(end < start){ end = start; }
+        if(c < threads - 1){
+            const char *newline = memchr(end, '\n', data + size - end);
+            end = newline == NULL ? data + size : newline + 1;
+        } else {
+            end = data + size;
+        }
+        chunks[c].start = start;
+        chunks[c].end = end;
+        chunks[c].fileEnd = data + size;
+        chunks[c].students = NULL;
+        chunks[c].count = 0;
+        chunks[c].max = 0;
+    }
+
+    //count lines so each chunk knows where the students in it begin
+    run_chunks(count_chunk_lines, chunks, threads);
+    for(int c = 0; c < threads; c++){
+        long inChunk = chunks[c].lines;
+        chunks[c].lines = lines;
+        lines += inChunk;
+    }
+    run_chunks(parse_chunk, chunks, threads);
+
+    //merge in file order
+    for(int c = 0; c < threads; c++){
+        for(int j = 0; j < chunks[c].count; j++){
+            append_student(chunks[c].students[j]);
+        }
+        free(chunks[c].students);
+    }
+
+    unmap_file(data, size);
+}
+
+/*
+    function to load the student file
+    falls back to importing the legacy text file only if there is no save file,
+    a save file that cannot be loaded stops the program so nothing overwrites it
+*/
+void load_student_file(){
+    FILE *file = fopen(ROSTER_FILE, "rb");
+
+    if(file == NULL && errno == ENOENT){
+        load_text_file();
+    } else {
+        if(file != NULL){
+            fclose(file);
+        }
+        if(file == NULL || !load_roster_file()){
+            //the journal holds changes to this save file, so neither is safe to replace
+            printf("...Unable to load %s. Repair or move it and %s aside, then restart\n", ROSTER_FILE, JOURNAL_FILE);
+            exit(1);
+        }
+    }
+
+    //apply changes made since the save file was last written
+    replay_journal();
+    open_journal();
+}
+
+/* 
+    create and return new student
+    ADD FORMAT CHECKER FOR EMAIL AND ID
+*/
+student create_student(){
+    student s;
+    char input[BUFFER];
+
+    //get name
+    printf("Enter student name (40 char max): ");
+    get_input(input);
+    while(strlen(input) == 0 || strlen(input) > MAX_STRING){
+        printf("Invalid name. Re-enter student name (40 char max): ");
+        get_input(input);
+    }
+    strcpy(s.name, input);
+
+    //get email
+    printf("Enter student email: ");
+    get_input(input);
+    while(strlen(input) == 0 || strlen(input) > MAX_STRING){
+        printf("Invalid name. Re-enter student email (40 char max): ");
+        get_input(input);
+    }
+    strcpy(s.email, input);
+
+    //get id
+    printf("Enter student UID: ");
+    get_input(input);
+    while(strlen(input) == 0 || strlen(input) > MAX_ID || id_check(input) == false
+          || index_lookup(FIELD_UID, input) != -1){
+        if(index_lookup(FIELD_UID, input) != -1){
+            printf("UID already exists. Re-enter student UID (10 char max): ");
+        } else {
+            printf("Invalid name. Re-enter student UID (10 char max): ");
+        }
+        get_input(input);
+    }
+    //check format
+    strcpy(s.id, input);
+
+    //get presentation grade
+    s.grades = pack_grades(ERR, ERR, ERR);
+    printf("Enter presentation grade (A, B, C, D, F): ");
+    get_input(input);
+    while(strlen(input) != 1 || convert_char_to_grade(input[0]) == ERR){
+        printf("Invalid grade. Re-enter presentation grade (A, B, C, D, F): ");
+        get_input(input);
+    }
+    s.grades = set_grade(s.grades, PRESENTATION, convert_char_to_grade(input[0]));
+
+    //get essay grade
+    printf("Enter essay grade (A, B, C, D, F): ");
+    get_input(input);
+    while(strlen(input) != 1 || convert_char_to_grade(input[0]) == ERR){
+        printf("Invalid grade. Re-enter essay grade (A, B, C, D, F): ");
+        get_input(input);
+    }
+    s.grades = set_grade(s.grades, ESSAY, convert_char_to_grade(input[0]));
+
+    //get project grade
+    printf("Enter project grade (A, B, C, D, F): ");
+    get_input(input);
+    while(strlen(input) != 1 || convert_char_to_grade(input[0]) == ERR){
+        printf("Invalid grade. Re-enter project grade (A, B, C, D, F): ");
+        get_input(input);
+    }
+    s.grades = set_grade(s.grades, PROJECT, convert_char_to_grade(input[0]));
+    return s;
+}
+
+/*
+    function to search for student***
+    RETURN POINTER OR INDEX
+*/
+int find_student(){
+    char input[BUFFER];
+    int parameter, valid = 0;
+
+    //get search parameter
+    printf("A: Name\nB: Email\nC: UID\nD: Exit\n");
+    printf("How would you like to search for the student?\n");
+    while(valid == 0){
+        printf("Enter letter of search parameter: ");
+        get_input(input);
+        if(strlen(input) == 1){
+            switch(input[0]){
+                case 'A': case 'a':
+                    parameter = 0;
+                    valid = 1;
+                    break;
+                case 'B': case 'b':
+                    parameter = 1;
+                    valid = 1;
+                    break;
+                case 'C': case 'c':
+                    parameter = 2;
                     valid = 1;
                     break;
                 case 'D': case 'd':
                     valid = 1;
                     return -1;
                     break;
-                default:
-                    valid = 0;
-                    break;
+                default:
+                    valid = 0;
+                    break;
+            }
+        }
+        if (valid == 0){
+            printf("Unknown parameter. Please try again.\n");
+        }
+    }
+
+    //get students info to search with
+    printf("Enter students ");
+    switch(parameter){
+        case 0:
+            printf("name: ");
+            get_input(input);
+            while(strlen(input) == 0 || strlen(input) > MAX_STRING){
+                printf("Invalid name. Re-enter student name (40 char max): ");
+                get_input(input);
+            }
+            break;
+        case 1:
+            printf("email: ");
+            get_input(input);
+            while(strlen(input) == 0 || strlen(input) > MAX_STRING){
+                printf("Invalid email. Re-enter student email (40 char max): ");
+                get_input(input);
+            }
+            break;
+        case 2:
+            printf("UID: ");
+            get_input(input);
+            while(strlen(input) == 0 || strlen(input) > MAX_ID){
+                printf("Invalid UID. Re-enter student UID (10 char max): ");
+                get_input(input);
+            }
+            break;
+        default:
+            printf("ERROR with parameter\n");
+            return -1;
+    }
+    
+    //search for student using the index of the given parameter
+    int i = index_lookup(parameter, input);
+    if(i != -1){
+        return i;
+    }
+    printf("Student does not exist\n");
+    return -1;
+}
+
+
+/*
+    function to get the student index of row k of a listing, from
+    slots if given or else by following the listing order
+*/
+int row_slot(const int *slots, int k, int previous){
+    if(slots != NULL){
+        return slots[k];
+    }
+    return k == 0 ? First : student_at(previous)->next;
+}
+
+/*
+    function to print students as a table, one row per student.
+    Column widths are found in a first pass over the rows
+*/
+void print_table(const int *slots, int n){
+    int nameWidth = 4, emailWidth = 5, idWidth = 3;   //widths of the headings
+    int i = -1;
+
+    for(int k = 0; k < n; k++){
+        i = row_slot(slots, k, i);
+        student_record *s = student_at(i);
+        int length;
+        if((length = strlen(s->name)) > nameWidth){
+            nameWidth = length;
+        }
+        if((length = strlen(s->email)) > emailWidth){
+            emailWidth = length;
+        }
+        if((length = strlen(s->id)) > idWidth){
+            idWidth = length;
+        }
+    }
+
+    write_padded("Name", nameWidth + 2);
+    write_padded("Email", emailWidth + 2);
+    write_padded("UID", idWidth + 2);
+    write_text("Pres  Essay  Proj\n");
+    for(int k = 0; k < n; k++){
+        i = row_slot(slots, k, i);
+        student_record *s = student_at(i);
+        char letters[3], grades[] = "?     ?      ?\n";
+        unpack_grade_chars(*grades_at(i), letters);
+        grades[0] = letters[0];
+        grades[6] = letters[1];
+        grades[13] = letters[2];
+        write_padded(s->name, nameWidth + 2);
+        write_padded(s->email, emailWidth + 2);
+        write_padded(s->id, idWidth + 2);
+        write_output(grades, sizeof(grades) - 1);
+    }
+}
+
+/*
+    function to print n students, as a table if TableView is set
+    or else field by field. slots holds their indexes, or is NULL
+    to print the first n students in listing order
+*/
+void print_students(const int *slots, int n){
+    if(TableView){
+        print_table(slots, n);
+    } else {
+        int i = -1;
+        for(int k = 0; k < n; k++){
+            student s;
+            i = row_slot(slots, k, i);
+            s = copy_student(i);
+            print_student(&s, false);
+            write_output("\n", 1);
+        }
+    }
+    flush_output();
+}
+
+/*
+    function to print students found by a search
+*/
+void print_results(int *results, int n){
+    print_students(results, n);
+    printf("...%d student%s found\n", n, n == 1 ? "" : "s");
+}
+
+/*
+    function to find every student whose name or email
+    starts with or contains the given text
+*/
+void search_students(){
+    char input[BUFFER];
+    int option = -1, n, *results;
+
+    printf("A: Name starts with\nB: Name contains\nC: Email starts with\nD: Email contains\nE: Exit\n");
+    while(option == -1){
+        printf("Enter letter of search type: ");
+        get_input(input);
+        if(strlen(input) == 1 && tolower(input[0]) >= 'a' && tolower(input[0]) <= 'e'){
+            option = tolower(input[0]) - 'a';
+        } else {
+            printf("Unknown search type. Please try again.\n");
+        }
+    }
+    if(option == 4){
+        return;
+    }
+
+    printf("Enter search text: ");
+    get_input(input);
+    while(strlen(input) == 0 || strlen(input) > MAX_STRING){
+        printf("Invalid text. Re-enter search text (40 char max): ");
+        get_input(input);
+    }
+
+    if(option % 2 == 0){
+        n = search_prefix(option < 2 ? FIELD_NAME : FIELD_EMAIL, input, &results);
+    } else {
+        n = search_substring(option < 2 ? FIELD_NAME : FIELD_EMAIL, input, &results);
+    }
+    print_results(results, n);
+    free(results);
+}
+
+/*
+    function to list students sorted by a field, optionally
+    only those between a lowest and highest value
+*/
+void sort_students(){
+    static const char *names[] = {"name", "email", "UID", "GPA"};
+    char low[BUFFER], high[BUFFER];
+    const char *error;
+    int option = -1, n, *results;
+    bool hasLow, hasHigh;
+
+    printf("A: Name\nB: Email\nC: UID\nD: GPA\nE: Exit\n");
+    while(option == -1){
+        printf("Enter letter of field to sort by: ");
+        get_input(low);
+        if(strlen(low) == 1 && tolower(low[0]) >= 'a' && tolower(low[0]) <= 'e'){
+            option = tolower(low[0]) - 'a';
+        } else {
+            printf("Unknown field. Please try again.\n");
+        }
+    }
+    if(option == 4){
+        return;
+    }
+
+    //blank bounds leave that end of the range open, get_input
+    //leaves a blank line as a lone newline so only whitespace counts as blank
+    printf("Enter lowest %s (blank for none): ", names[option]);
+    get_input(low);
+    while((hasLow = strspn(low, " \t\r\n") < strlen(low)) && (error = check_bound(option, low)) != NULL){
+        printf("%s. Re-enter lowest %s: ", error, names[option]);
+        get_input(low);
+    }
+    printf("Enter highest %s (blank for none): ", names[option]);
+    get_input(high);
+    while((hasHigh = strspn(high, " \t\r\n") < strlen(high)) && (error = check_bound(option, high)) != NULL){
+        printf("%s. Re-enter highest %s: ", error, names[option]);
+        get_input(high);
+    }
+
+    n = search_range(option, hasLow ? low : NULL, hasHigh ? high : NULL, &results);
+    print_results(results, n);
+    free(results);
+}
+
+/*
+    function to remove student from save file***
+*/
+void remove_student(){
+    int i;
+    //find student(get pointer to student)
+    i = find_student();
+    if(i == -1){
+        return;
+    }
+    //record removal in journal, then remove from array
+    journal_write('R', student_at(i)->id, NULL);
+    delete_student(i);
+}
+
+
+
+
+/*
+    function to update specific field of student
+*/
+
+student update_student_field(student s, int fieldToChange){
+    char input[BUFFER];
+
+    switch(fieldToChange){
+        case 1:
+            printf("Enter student name (40 char max): ");
+            get_input(input);
+            while(strlen(input) == 0 || strlen(input) > MAX_STRING){
+                printf("Invalid name. Re-enter student name (40 char max): ");
+                get_input(input);
+            }
+            strcpy(s.name, input);
+            break;
+        case 2:
+            printf("Enter student email: ");
+            get_input(input);
+            while(strlen(input) == 0 || strlen(input) > MAX_STRING){
+                printf("Invalid name. Re-enter student email (40 char max): ");
+                get_input(input);
+            }
+            strcpy(s.email, input);
+            break;
+        case 3:
+            printf("Enter student UID: ");
+            get_input(input);
+            while(strlen(input) == 0 || strlen(input) > MAX_ID || id_check(input) == false
+                  || (strcmp(input, s.id) != 0 && index_lookup(FIELD_UID, input) != -1)){
+                if(strcmp(input, s.id) != 0 && index_lookup(FIELD_UID, input) != -1){
+                    printf("UID already exists. Re-enter student UID (10 char max): ");
+                } else {
+                    printf("Invalid name. Re-enter student UID (10 char max): ");
+                }
+                get_input(input);
+            }
+            //check format
+            strcpy(s.id, input);
+            break;
+        case 4:
+            printf("Enter presentation grade (A, B, C, D, F): ");
+            get_input(input);
+            while(strlen(input) != 1 || convert_char_to_grade(input[0]) == ERR){
+                printf("Invalid grade. Re-enter presentation grade (A, B, C, D, F): ");
+                get_input(input);
+            }
+            s.grades = set_grade(s.grades, PRESENTATION, convert_char_to_grade(input[0]));
+            break;
+        case 5:
+            printf("Enter essay grade (A, B, C, D, F): ");
+            get_input(input);
+            while(strlen(input) != 1 || convert_char_to_grade(input[0]) == ERR){
+                printf("Invalid grade. Re-enter essay grade (A, B, C, D, F): ");
+                get_input(input);
+            }
+            s.grades = set_grade(s.grades, ESSAY, convert_char_to_grade(input[0]));
+            break;
+        case 6:
+            printf("Enter project grade (A, B, C, D, F): ");
+            get_input(input);
+            while(strlen(input) != 1 || convert_char_to_grade(input[0]) == ERR){
+                printf("Invalid grade. Re-enter project grade (A, B, C, D, F): ");
+                get_input(input);
+            }
+            s.grades = set_grade(s.grades, PROJECT, convert_char_to_grade(input[0]));
+            break;
+        default:
+            printf("Error");
+    }
+
+    return s;
+}
+
+/*
+    function to update student***
+*/
+void update_student(){
+    char c, input[BUFFER];
+    printf("...updating student\n");
+
+    //Access array to edit student
+    int arrayIndex = find_student();
+    if (arrayIndex == -1){
+        return;
+    }
+
+    //Initial Student found from find_student to update
+    student studentToUpdate = copy_student(arrayIndex);
+
+    //Student After Update
+    student updatedStudent = studentToUpdate;
+
+    //Keep Asking for updates before exiting
+    bool keepRunning = true;
+    while(keepRunning){
+
+        //Pass in True since it will show A, B, C, .. next to entries
+        print_student(&updatedStudent, true);
+        flush_output();
+
+        printf("Select an option for which field to update\n");
+        get_input(input);
+        c = input[0];
+        switch(c){
+            case 'A':
+            case 'a':
+                updatedStudent = update_student_field(studentToUpdate, 1);
+                break;
+            case 'B':
+            case 'b':
+                updatedStudent = update_student_field(studentToUpdate, 2);
+                break;
+            case 'C':
+            case 'c':
+                updatedStudent = update_student_field(studentToUpdate, 3);
+                break;
+            case 'D':
+            case 'd':
+                updatedStudent = update_student_field(studentToUpdate, 4);
+                break;
+            case 'E':
+            case 'e':
+                updatedStudent = update_student_field(studentToUpdate, 5);
+                break;
+            case 'F':
+            case 'f':
+                updatedStudent = update_student_field(studentToUpdate, 6);
+                break;
+            case 'G':
+            case 'g':
+                keepRunning = false;
+                break;
+        }
+    }
+
+    //record update in journal, then re-index student under its updated fields
+    journal_write('U', studentToUpdate.id, &updatedStudent);
+    replace_student(arrayIndex, updatedStudent);
+
+}
+
+
+
+
+
+/* ================================================================================================================== */
+/* CSV FUNCTIONS */
+
+/*
+    splits one CSV line into at most max fields, in place
+    fields may be "quoted", with "" standing for a literal quote
+    returns number of fields, or -1 if there are too many or a quote is not closed
+*/
+int split_csv(char *line, char **fields, int max){
+    char *r = line, *w = line;
+    int n = 0;
+
+    while(true){
+        char c;
+
+        if(n == max){
+            return -1;
+        }
+        fields[n++] = w;
+
+        //copy field over itself, dropping quotes
+        if(*r == '"'){
+            r++;
+            while(true){
+                if(*r == '\0'){
+                    return -1;
+                }
+                if(*r == '"'){
+                    if(r[1] != '"'){
+                        r++;
+                        break;
+                    }
+                    r++;
+                }
+                *w++ = *r++;
+            }
+        }
+        while(*r != ',' && *r != '\0'){
+            *w++ = *r++;
+        }
+
+        //end field, w never passes r so nothing unread is overwritten
+        c = *r;
+        *w++ = '\0';
+        if(c == '\0'){
+            return n;
+        }
+        r++;
+    }
+}
+
+/*
+    parses one CSV row and appends it as a new student
+    columns are name,email,uid,presentation,essay,project
+    returns an error message, or NULL if the student was added
+*/
+const char *import_csv_row(char *line){
+    static const char *columns[] = {"name", "email", "uid", "presentation", "essay", "project"};
+    char *fields[6];
+    const char *error;
+    student s;
+
+    if(split_csv(line, fields, 6) != 6){
+        return "expected name,email,uid,presentation,essay,project";
+    }
+    s.grades = pack_grades(ERR, ERR, ERR);
+    for(int n = 0; n < 6; n++){
+        if((error = set_student_field(&s, columns[n], fields[n])) != NULL){
+            return error;
+        }
+    }
+    if(index_lookup(FIELD_UID, s.id) != -1){
+        return "UID already exists";
+    }
+    append_student(s);
+    return NULL;
+}
+
+/*
+    appends every valid row of a CSV file to Students without prompting
+    the file is read CSV_CHUNK bytes at a time, an optional header row is skipped
+    returns number of students added, or -1 if the file could not be opened
+    changes are not journaled, caller must save afterwards
+*/
+long import_csv(const char *path){
+    FILE *file = fopen(path, "rb");
+    char *chunk;
+    size_t length = 0, start;
+    long lineNumber = 0, added = 0, rejected = 0;
+    bool eof = false, skipping = false;
+
+    if(file == NULL){
+        return -1;
+    }
+    chunk = malloc(CSV_CHUNK + 1);
+    if(chunk == NULL){
+        printf("...memory not allocated\n");
+        exit(1);
+    }
+
+    while(!eof){
+        //top up chunk after the carried over partial line
+        length += fread(chunk + length, 1, CSV_CHUNK - length, file);
+        eof = feof(file) || ferror(file);
+
+        start = 0;
+        while(start < length){
+            char *line = chunk + start;
+            char *end = memchr(line, '\n', length - start);
+            const char *error;
+
+            //partial line, wait for the rest unless nothing more is coming
+            if(end == NULL){
+                if(!eof){
+                    break;
+                }
+                end = chunk + length;
+            }
+            *end = '\0';
+            start = end - chunk + 1;
+
+            //rest of a line that was too long
+            if(skipping){
+                skipping = false;
+                continue;
+            }
+            lineNumber++;
+
+            //strip carriage return of \r\n line endings
+            if(end > line && end[-1] == '\r'){
+                end[-1] = '\0';
+            }
+            //skip blank lines and header row
+            if(line[0] == '\0' || (lineNumber == 1 && strcmp(line, CSV_HEADER) == 0)){
+                continue;
+            }
+
+            if((error = import_csv_row(line)) != NULL){
+                fprintf(stderr, "%s:%ld: %s\n", path, lineNumber, error);
+                rejected++;
+            } else {
+                added++;
             }
         }
-        if (valid == 0){
-            printf("Unknown parameter. Please try again.\n");
+
+        //no newline in a full chunk, drop it and skip the rest of the line
+        if(start == 0 && length == CSV_CHUNK){
+            if(!skipping){
+                lineNumber++;
+                fprintf(stderr, "%s:%ld: line too long\n", path, lineNumber);
+                rejected++;
+            }
+            skipping = true;
+            start = length;
+        }
+
+        //move partial line to front of chunk
+        if(start < length){
+            memmove(chunk, chunk + start, length - start);
+            length -= start;
+        } else {
+            length = 0;
         }
     }
 
-    //get students info to search with
-    printf("Enter students ");
-    switch(parameter){
-        case 0:
-            printf("name: ");
-            get_input(input);
-            while(strlen(input) == 0 || strlen(input) > MAX_STRING){
-                printf("Invalid name. Re-enter student name (40 char max): ");
-                get_input(input);
+    free(chunk);
+    fclose(file);
+    printf("...imported %ld students (%ld rows rejected)\n", added, rejected);
+    return added;
+}
+
+/*
+    copies str into a CSV field at out, quoting it if needed
+    returns number of bytes written
+*/
+size_t write_csv_field(char *out, const char *str){
+    char *w = out;
+
+    if(strpbrk(str, ",\"") == NULL){
+        size_t length = strlen(str);
+        memcpy(out, str, length);
+        return length;
+    }
+    *w++ = '"';
+    while(*str != '\0'){
+        if(*str == '"'){
+            *w++ = '"';
+        }
+        *w++ = *str++;
+    }
+    *w++ = '"';
+    return w - out;
+}
+
+/*
+    writes all students in listing order to a CSV file with a header row
+    rows are gathered in one CSV_CHUNK buffer and written when it fills
+    the file is written to <path>.tmp and renamed over path once complete
+    returns number of students written, or -1 if the file could not be written
+*/
+long export_csv(const char *path){
+    char tmpPath[FILENAME_MAX];
+    FILE *file;
+    char *buffer;
+    size_t used;
+    long written = 0;
+    bool ok;
+
+    if(snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path) >= (int)sizeof(tmpPath)){
+        return -1;
+    }
+    file = fopen(tmpPath, "wb");
+    if(file == NULL){
+        return -1;
+    }
+    buffer = malloc(CSV_CHUNK);
+    if(buffer == NULL){
+        printf("...memory not allocated\n");
+        exit(1);
+    }
+
+    used = sprintf(buffer, CSV_HEADER "\n");
+    for(int i = First; i != -1; i = student_at(i)->next){
+        student_record *s = student_at(i);
+        char grades[3];
+
+        //longest row is every character quoted and doubled, plus separators
+        if(CSV_CHUNK - used < 4 * (MAX_STRING + 3) + 16){
+            fwrite(buffer, 1, used, file);
+            used = 0;
+        }
+        used += write_csv_field(buffer + used, s->name);
+        buffer[used++] = ',';
+        used += write_csv_field(buffer + used, s->email);
+        buffer[used++] = ',';
+        used += write_csv_field(buffer + used, s->id);
+        buffer[used++] = ',';
+        unpack_grade_chars(*grades_at(i), grades);
+        buffer[used++] = grades[0];
+        buffer[used++] = ',';
+        buffer[used++] = grades[1];
+        buffer[used++] = ',';
+        buffer[used++] = grades[2];
+        buffer[used++] = '\n';
+        written++;
+    }
+    fwrite(buffer, 1, used, file);
+    free(buffer);
+
+    //a failed write sets the error flag, and fclose reports data it could not flush
+    ok = !ferror(file);
+    if(fclose(file) != 0){
+        ok = false;
+    }
+    if(!ok){
+        remove(tmpPath);
+        return -1;
+    }
+
+    //replace old file only once the new one is fully written
+#if defined(_WIN32)
+    remove(path);
+#endif
+    if(rename(tmpPath, path) != 0){
+        remove(tmpPath);
+        return -1;
+    }
+    return written;
+}
+
+/* ================================================================================================================== */
+/* STATS FUNCTIONS */
+
+/*
+    adds the number of words of grades holding each grade value in each
+    component to counts, indexed by component then grade value
+    anything that is not a grade, such as ERR, is not counted
+*/
+void count_grades_scalar(const packed_grades *grades, long n, long counts[][GRADE_LEVELS]){
+    for(long i = 0; i < n; i++){
+        for(int c = PRESENTATION; c <= PROJECT; c++){
+            grade g = get_grade(grades[i], c);
+            if(g < GRADE_LEVELS){
+                counts[c][g]++;
             }
-            break;
-        case 1:
-            printf("email: ");
-            get_input(input);
-            while(strlen(input) == 0 || strlen(input) > MAX_STRING){
-                printf("Invalid email. Re-enter student email (40 char max): ");
-                get_input(input);
+        }
+    }
+}
+
+#if defined(__SSE2__)
+/*
+    SSE2 version of count_grades_scalar, 8 packed words per compare
+    each component is shifted down and masked in every 16 bit lane, and each
+    compare subtracts 0 or -1 from a lane counter, so the counters are summed
+    into counts with _mm_madd_epi16 every 32767 rounds, before they turn negative
+*/
+void count_grades_sse2(const packed_grades *grades, long n, long counts[][GRADE_LEVELS]){
+    const __m128i mask = _mm_set1_epi16(GRADE_MASK);
+    long i = 0;
+
+    while(i + 8 <= n){
+        __m128i sums[3][GRADE_LEVELS];
+        long end = n - i > 8L * 32767 ? i + 8L * 32767 : n;
+
+        for(int c = PRESENTATION; c <= PROJECT; c++){
+            for(int g = 0; g < GRADE_LEVELS; g++){
+                sums[c][g] = _mm_setzero_si128();
             }
-            break;
-        case 2:
-            printf("UID: ");
-            get_input(input);
-            while(strlen(input) == 0 || strlen(input) > MAX_ID){
-                printf("Invalid UID. Re-enter student UID (10 char max): ");
-                get_input(input);
+        }
+        for(; i + 8 <= end; i += 8){
+            __m128i v = _mm_loadu_si128((const __m128i *)(grades + i));
+            for(int c = PRESENTATION; c <= PROJECT; c++){
+                __m128i field = _mm_and_si128(_mm_srli_epi16(v, c * GRADE_BITS), mask);
+                for(int g = 0; g < GRADE_LEVELS; g++){
+                    sums[c][g] = _mm_sub_epi16(sums[c][g], _mm_cmpeq_epi16(field, _mm_set1_epi16((short)g)));
+                }
+            }
+        }
+        for(int c = PRESENTATION; c <= PROJECT; c++){
+            for(int g = 0; g < GRADE_LEVELS; g++){
+                int32_t lanes[4];
+                _mm_storeu_si128((__m128i *)lanes, _mm_madd_epi16(sums[c][g], _mm_set1_epi16(1)));
+                counts[c][g] += (long)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+            }
+        }
+    }
+    count_grades_scalar(grades + i, n - i, counts);
+}
+#endif
+
+#if defined(HAVE_AVX2)
+/*
+    AVX2 version of count_grades_sse2, 16 packed words per compare
+    only called once __builtin_cpu_supports has found AVX2
+*/
+__attribute__((target("avx2")))
+void count_grades_avx2(const packed_grades *grades, long n, long counts[][GRADE_LEVELS]){
+    const __m256i mask = _mm256_set1_epi16(GRADE_MASK);
+    long i = 0;
+
+    while(i + 16 <= n){
+        __m256i sums[3][GRADE_LEVELS];
+        long end = n - i > 16L * 32767 ? i + 16L * 32767 : n;
+
+        for(int c = PRESENTATION; c <= PROJECT; c++){
+            for(int g = 0; g < GRADE_LEVELS; g++){
+                sums[c][g] = _mm256_setzero_si256();
+            }
+        }
+        for(; i + 16 <= end; i += 16){
+            __m256i v = _mm256_loadu_si256((const __m256i *)(grades + i));
+            for(int c = PRESENTATION; c <= PROJECT; c++){
+                __m256i field = _mm256_and_si256(_mm256_srli_epi16(v, c * GRADE_BITS), mask);
+                for(int g = 0; g < GRADE_LEVELS; g++){
+                    sums[c][g] = _mm256_sub_epi16(sums[c][g], _mm256_cmpeq_epi16(field, _mm256_set1_epi16((short)g)));
+                }
             }
+        }
+        for(int c = PRESENTATION; c <= PROJECT; c++){
+            for(int g = 0; g < GRADE_LEVELS; g++){
+                int32_t lanes[8];
+                _mm256_storeu_si256((__m256i *)lanes, _mm256_madd_epi16(sums[c][g], _mm256_set1_epi16(1)));
+                counts[c][g] += (long)lanes[0] + lanes[1] + lanes[2] + lanes[3] +
+                                lanes[4] + lanes[5] + lanes[6] + lanes[7];
+            }
+        }
+    }
+    count_grades_scalar(grades + i, n - i, counts);
+}
+#endif
+
+/*
+    adds a histogram of each component of n contiguous packed grades to counts
+    uses the widest vector unit the CPU has
+*/
+void count_grades(const packed_grades *grades, long n, long counts[][GRADE_LEVELS]){
+#if defined(HAVE_AVX2)
+    static int avx2 = -1;                   //-1 until the CPU is first checked
+    if(avx2 == -1){
+        avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+    if(avx2){
+        count_grades_avx2(grades, n, counts);
+        return;
+    }
+#endif
+#if defined(__SSE2__)
+    count_grades_sse2(grades, n, counts);
+#else
+    count_grades_scalar(grades, n, counts);
+#endif
+}
+
+/*
+    returns the median grade of a histogram holding total grades
+    the mean of the two middle grades if total is even
+*/
+double median_grade(const long *counts, long total){
+    long seen = 0;
+    int low = -1, high = -1;
+
+    for(int g = 0; g < GRADE_LEVELS; g++){
+        seen += counts[g];
+        if(low == -1 && seen > (total - 1) / 2){
+            low = g;
+        }
+        if(high == -1 && seen > total / 2){
+            high = g;
+        }
+    }
+    return (low + high) / 2.0;
+}
+
+/*
+    fills one grade_stats per component (presentation, essay, project)
+    count_grades reads each segment of the Grades column where it lies,
+    removed slots are all ERR so they are not counted
+*/
+void grade_statistics(grade_stats *stats){
+    long counts[3][GRADE_LEVELS] = {{0}};
+
+    memset(stats, 0, sizeof(grade_stats) * 3);
+    for(int j = 0; j < segments; j++){
+        int n = slotCount - j * SEGMENT_SIZE < SEGMENT_SIZE ? slotCount - j * SEGMENT_SIZE : SEGMENT_SIZE;
+        count_grades(Grades[j], n, counts);
+    }
+    for(int c = 0; c < 3; c++){
+        for(int g = 0; g < GRADE_LEVELS; g++){
+            stats[c].counts[g] = counts[c][g];
+            stats[c].total += stats[c].counts[g];
+            stats[c].sum += (long)g * stats[c].counts[g];
+        }
+    }
+}
+
+/*
+    prints the grade histogram, mean and median of each component
+    and the roster's overall GPA, the mean of every grade on the 0-4 scale
+*/
+void print_grade_statistics(){
+    static const char *names[] = {"Presentation", "Essay", "Project"};
+    grade_stats stats[3];
+    long total = 0, sum = 0;
+
+    if(count == 0){
+        printf("ERR: No students exist. Enter \"a\" to add a new student.\n");
+        return;
+    }
+    grade_statistics(stats);
+    printf("Students: %d\n", count);
+    printf("%-14s%9s%9s%9s%9s%9s%8s%8s\n", "Component", "A", "B", "C", "D", "F", "Mean", "Median");
+    for(int c = 0; c < 3; c++){
+        printf("%-14s", names[c]);
+        for(int g = A; g >= F; g--){
+            printf("%9ld", stats[c].counts[g]);
+        }
+        printf("%8.2f%8.1f\n", stats[c].total > 0 ? (double)stats[c].sum / stats[c].total : 0.0,
+               stats[c].total > 0 ? median_grade(stats[c].counts, stats[c].total) : 0.0);
+        total += stats[c].total;
+        sum += stats[c].sum;
+    }
+    printf("Overall GPA: %.2f\n", total > 0 ? (double)sum / total : 0.0);
+}
+
+/*
+    returns the score of slot i for ranking by metric, a component or RANK_GPA
+    returns -1 if the slot has no grade to rank, as removed slots never do
+    reads only the Grades column
+*/
+double rank_score(int i, int metric){
+    packed_grades p = *grades_at(i);
+    grade g;
+
+    if(metric == RANK_GPA){
+        return student_gpa(p);
+    }
+    g = get_grade(p, metric);
+    return g == ERR ? -1.0 : (double)g;
+}
+
+/*
+    orders two ranked students, returns < 0 if a ranks ahead of b
+    higher scores rank ahead when top is set, lower ones otherwise,
+    and equal scores rank by UID
+*/
+int compare_rank(const rank_entry *a, const rank_entry *b, bool top){
+    int order;
+    if(a->score != b->score){
+        return (a->score > b->score) == top ? -1 : 1;
+    }
+    if(a->uid != b->uid){
+        return a->uid < b->uid ? -1 : 1;
+    }
+    order = strcmp(student_at(a->student)->id, student_at(b->student)->id);
+    if(order != 0){
+        return order;
+    }
+    return (a->student > b->student) - (a->student < b->student);
+}
+
+/*
+    moves heap entry k down until neither child ranks behind it
+    the root of the heap is the entry that ranks last
+*/
+void rank_sift_down(rank_entry *heap, int n, int k, bool top){
+    rank_entry entry = heap[k];
+    while(2 * k + 1 < n){
+        int child = 2 * k + 1;
+        if(child + 1 < n && compare_rank(&heap[child + 1], &heap[child], top) > 0){
+            child++;
+        }
+        if(compare_rank(&heap[child], &entry, top) <= 0){
             break;
-        default:
-            printf("ERROR with parameter\n");
-            return -1;
+        }
+        heap[k] = heap[child];
+        k = child;
+    }
+    heap[k] = entry;
+}
+
+/*
+    moves heap entry k up until its parent ranks behind it
+*/
+void rank_sift_up(rank_entry *heap, int k, bool top){
+    rank_entry entry = heap[k];
+    while(k > 0 && compare_rank(&heap[(k - 1) / 2], &entry, top) < 0){
+        heap[k] = heap[(k - 1) / 2];
+        k = (k - 1) / 2;
+    }
+    heap[k] = entry;
+}
+
+/*
+    returns number of students with a score for metric
+*/
+int rank_eligible(int metric){
+    int n = 0;
+    for(int i = 0; i < slotCount; i++){
+        if(rank_score(i, metric) >= 0){
+            n++;
+        }
     }
-    
-    //search for student using given parameter and information
-    for(int i = 0; i < count; i++){
-        switch(parameter){
-            case 0:
-                if (strcmp(Students[i].name, input) == 0){
-                    return i;
-                }
-                break;
-            case 1:
-                if (strcmp(Students[i].email, input) == 0){
-                    return i;
-                }
-                break;
-            case 2:
-                if (strcmp(Students[i].id, input) == 0){
-                    return i;
-                }
-                break;
-            default:
-                printf("ERROR searching\n");
-                return -1;
+    return n;
+}
+
+/*
+    finds the k students that rank first by metric, highest scores
+    if top is set or lowest otherwise, in O(N log k) with a bounded heap
+    sets results to a malloc'd array of student indexes in rank order,
+    returns its length, which is less than k if fewer students have scores
+*/
+int rank_students(int metric, bool top, int k, int **results){
+    rank_entry *heap = malloc(sizeof(rank_entry) * (k > 0 ? k : 1));
+    int n = 0;
+
+    *results = malloc(sizeof(int) * (k > 0 ? k : 1));
+    if(heap == NULL || *results == NULL){
+        printf("...memory not allocated\n");
+        exit(1);
+    }
+
+    //keep the k best seen so far, with the one that ranks last at the root
+    for(int i = 0; i < slotCount && k > 0; i++){
+        rank_entry entry;
+        entry.score = rank_score(i, metric);
+        entry.student = i;
+        if(entry.score < 0){
+            continue;
+        }
+
+        //a full heap only takes scores at least as good as its last ranked
+        if(n == k && entry.score != heap[0].score && (entry.score > heap[0].score) != top){
+            continue;
+        }
+        entry.uid = strtoull(student_at(i)->id, NULL, 10);
+        if(n < k){
+            heap[n] = entry;
+            rank_sift_up(heap, n++, top);
+        } else if(compare_rank(&entry, &heap[0], top) < 0){
+            heap[0] = entry;
+            rank_sift_down(heap, n, 0, top);
         }
     }
-    printf("Student does not exist\n");
-    return -1;
+
+    //take the last ranked off the heap each time, filling results from the back
+    for(int j = n - 1; j >= 0; j--){
+        (*results)[j] = heap[0].student;
+        heap[0] = heap[j];
+        rank_sift_down(heap, j, 0, top);
+    }
+    free(heap);
+    return n;
 }
 
+/*
+    parses how many students a ranking returns, either a count
+    or a percentage of the students with a score for metric, as in "10%"
+    returns the count, or -1 if text is neither
+*/
+int rank_count(const char *text, int metric){
+    char *end;
+    double value = strtod(text, &end);
+
+    if(end == text || value < 0){
+        return -1;
+    }
+    if(*end == '%' && end[1] == '\0' && value <= 100){
+        int eligible = rank_eligible(metric);
+        int k = (int)(eligible * value / 100);
+        return k < eligible * value / 100 ? k + 1 : k;
+    }
+    if(*end != '\0' || value != (long long)value){
+        return -1;
+    }
+    return value > slotCount ? slotCount : (int)value;
+}
 
 /*
-    function to remove student from save file***
+    function to list the students with the highest or lowest
+    GPA or grade in a component
 */
-void remove_student(){
-    int i;
-    //find student(get pointer to student)
-    i = find_student();
-    if(i == -1){
+void show_rankings(){
+    static const char *names[] = {"presentation grade", "essay grade", "project grade", "GPA"};
+    char input[BUFFER];
+    int option = -1, k, n, *results;
+    bool top;
+
+    printf("A: Presentation\nB: Essay\nC: Project\nD: GPA\nE: Exit\n");
+    while(option == -1){
+        printf("Enter letter of grade to rank by: ");
+        get_input(input);
+        if(strlen(input) == 1 && tolower(input[0]) >= 'a' && tolower(input[0]) <= 'e'){
+            option = tolower(input[0]) - 'a';
+        } else {
+            printf("Unknown grade. Please try again.\n");
+        }
+    }
+    if(option == 4){
         return;
     }
-    //remove from array by moving all students after selected student forward once
-    for(int j = i + 1; j < count; j++){
-        strcpy(Students[i].name, Students[j].name);
-        strcpy(Students[i].email, Students[j].email);
-        strcpy(Students[i].id, Students[j].id);
-        Students[i].presentation = Students[j].presentation;
-        Students[i].essay = Students[j].essay;
-        Students[i].project = Students[j].project;
-        i++;
+
+    printf("Enter T for highest %s or B for lowest: ", names[option]);
+    get_input(input);
+    while(strlen(input) != 1 || (tolower(input[0]) != 't' && tolower(input[0]) != 'b')){
+        printf("Invalid choice. Enter T or B: ");
+        get_input(input);
+    }
+    top = tolower(input[0]) == 't';
+
+    printf("Enter number of students, or percentage such as 10%%: ");
+    get_input(input);
+    while((k = rank_count(input, option)) == -1){
+        printf("Invalid number. Re-enter number of students: ");
+        get_input(input);
     }
-    count = count - 1;
 
-    //rewrite save file
-    save_student_file();
+    n = rank_students(option, top, k, &results);
+    print_students(results, n);
+    printf("...%d student%s ranked\n", n, n == 1 ? "" : "s");
+    free(results);
+}
+
+/* ================================================================================================================== */
+/* BATCH FUNCTIONS */
+
+/*
+    returns seconds elapsed on a monotonic-enough wall clock
+*/
+double seconds_now(){
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+    splits "key=value key=value ..." into pairs, in place
+    a word without a known "key=" prefix continues the previous value,
+    so values may contain spaces
+    returns number of pairs, or -1 if text does not start with a pair
+*/
+int split_pairs(char *text, char **keys, char **values, int max){
+    static const char *names[] = {"name", "email", "uid", "presentation", "essay", "project"};
+    int n = 0;
+    char *ptr = text;
+
+    while(*ptr != '\0'){
+        char *eq = strchr(ptr, '=');
+        size_t wordLength = strcspn(ptr, " ");
+        bool isKey = false;
+
+        //a new pair starts where a known field name is followed by '='
+        if(eq != NULL && wordLength > (size_t)(eq - ptr)){
+            for(int k = 0; k < 6; k++){
+                if(strlen(names[k]) == (size_t)(eq - ptr) && strncmp(ptr, names[k], eq - ptr) == 0){
+                    isKey = true;
+                }
+            }
+        }
+        if(isKey && n < max){
+            if(ptr != text){
+                ptr[-1] = '\0';
+            }
+            *eq = '\0';
+            keys[n] = ptr;
+            values[n] = eq + 1;
+            n++;
+        } else if(n == 0){
+            return -1;
+        }
+
+        //skip to start of next word
+        ptr += wordLength;
+        if(*ptr == ' '){ ptr++; }
+    }
+    return n;
 }
 
+/*
+    returns index of the student selected by a name=, email= or uid= pair
+    returns -1 if none matches
+*/
+int select_student(const char *key, const char *value){
+    if(strcmp(key, "name") == 0){ return index_lookup(FIELD_NAME, value); }
+    if(strcmp(key, "email") == 0){ return index_lookup(FIELD_EMAIL, value); }
+    if(strcmp(key, "uid") == 0){ return index_lookup(FIELD_UID, value); }
+    return -1;
+}
 
+/*
+    returns the field called name that students can be sorted by, or -1
+*/
+int sort_field(const char *name){
+    static const char *names[] = {"name", "email", "uid", "gpa"};
+    for(int f = FIELD_NAME; f <= FIELD_GPA; f++){
+        if(strcmp(name, names[f]) == 0){
+            return f;
+        }
+    }
+    return -1;
+}
 
+/*
+    returns the score called name that students can be ranked by, or -1
+*/
+int rank_metric(const char *name){
+    static const char *names[] = {"presentation", "essay", "project", "gpa"};
+    for(int m = PRESENTATION; m <= RANK_GPA; m++){
+        if(strcmp(name, names[m]) == 0){
+            return m;
+        }
+    }
+    return -1;
+}
 
 /*
-    function to update specific field of student
+    runs a single batch command
+    returns an error message, or NULL if the command succeeded
 */
+const char *run_batch_command(char *line){
+    char *keys[8], *values[8];
+    char *args = line + strcspn(line, " ");
+    const char *error;
+    student s;
+    int i, n;
 
-student update_student_field(student s, int fieldToChange){
-    char input[BUFFER];
+    if(*args != '\0'){
+        *args = '\0';
+        args++;
+    }
 
-    switch(fieldToChange){
-        case 1:
-            printf("Enter student name (40 char max): ");
-            get_input(input);
-            while(strlen(input) == 0 || strlen(input) > MAX_STRING){
-                printf("Invalid name. Re-enter student name (40 char max): ");
-                get_input(input);
-            }
-            strcpy(s.name, input);
-            break;
-        case 2:
-            printf("Enter student email: ");
-            get_input(input);
-            while(strlen(input) == 0 || strlen(input) > MAX_STRING){
-                printf("Invalid name. Re-enter student email (40 char max): ");
-                get_input(input);
+    if(strcmp(line, "add") == 0){
+        //add name,email,uid,presentation,essay,project is one CSV row
+        return import_csv_row(args);
+    } else if(strcmp(line, "import") == 0){
+        trim_string(args);
+        if(import_csv(args) == -1){
+            return "unable to open CSV file";
+        }
+    } else if(strcmp(line, "export") == 0){
+        trim_string(args);
+        if(export_csv(args) == -1){
+            return "unable to write CSV file";
+        }
+    } else if(strcmp(line, "ignorecase") == 0){
+        //ignorecase on or ignorecase off
+        trim_string(args);
+        if(strcmp(args, "on") != 0 && strcmp(args, "off") != 0){
+            return "expected ignorecase on or ignorecase off";
+        }
+        IgnoreCase = strcmp(args, "on") == 0;
+    } else if(strcmp(line, "list") == 0){
+        //list every student in listing order
+        print_students(NULL, count);
+    } else if(strcmp(line, "sort") == 0){
+        //sort gpa lists everyone by GPA, sort name Adams,Baker only those in range,
+        //either end of the range may be left empty
+        char *range = args + strcspn(args, " "), *low = NULL, *high = NULL;
+        int f, *results;
+        if(*range != '\0'){
+            *range++ = '\0';
+            trim_string(range);
+        }
+        if((f = sort_field(args)) == -1){
+            return "expected sort name, email, uid or gpa";
+        }
+        if(*range != '\0'){
+            char *comma = strchr(range, ',');
+            if(comma == NULL){
+                return "expected a range such as low,high";
             }
-            strcpy(s.email, input);
-            break;
-        case 3:
-            printf("Enter student UID: ");
-            get_input(input);
-            while(strlen(input) == 0 || strlen(input) > MAX_ID || id_check(input) == false){
-                printf("Invalid name. Re-enter student UID (10 char max): ");
-                get_input(input);
+            *comma = '\0';
+            trim_string(range);
+            trim_string(comma + 1);
+            low = *range != '\0' ? range : NULL;
+            high = comma[1] != '\0' ? comma + 1 : NULL;
+            if((low != NULL && (error = check_bound(f, low)) != NULL)
+              || (high != NULL && (error = check_bound(f, high)) != NULL)){
+                return error;
             }
-            //check format
-            strcpy(s.id, input);
-            break;
-        case 4:
-            printf("Enter presentation grade (A, B, C, D, F): ");
-            get_input(input);
-            while(strlen(input) != 1 || convert_char_to_grade(input[0]) == ERR){
-                printf("Invalid grade. Re-enter presentation grade (A, B, C, D, F): ");
-                get_input(input);
+        }
+        n = search_range(f, low, high, &results);
+        print_results(results, n);
+        free(results);
+    } else if(strcmp(line, "rank") == 0){
+        //rank gpa top 50 or rank essay bottom 10%
+        char *words[3];
+        int metric, k, *results;
+        for(n = 0; n < 3 && *args != '\0'; n++){
+            words[n] = args;
+            args += strcspn(args, " ");
+            if(*args != '\0'){
+                *args++ = '\0';
             }
-            s.presentation = convert_char_to_grade(input[0]);
-            break;
-        case 5:
-            printf("Enter essay grade (A, B, C, D, F): ");
-            get_input(input);
-            while(strlen(input) != 1 || convert_char_to_grade(input[0]) == ERR){
-                printf("Invalid grade. Re-enter essay grade (A, B, C, D, F): ");
-                get_input(input);
+        }
+        if(n != 3 || *args != '\0' || (metric = rank_metric(words[0])) == -1
+          || (strcmp(words[1], "top") != 0 && strcmp(words[1], "bottom") != 0)){
+            return "expected rank <presentation|essay|project|gpa> <top|bottom> <count or percent%>";
+        }
+        if((k = rank_count(words[2], metric)) == -1){
+            return "expected a count of students or a percentage such as 10%";
+        }
+        n = rank_students(metric, words[1][0] == 't', k, &results);
+        print_students(results, n);
+        printf("...%d student%s ranked\n", n, n == 1 ? "" : "s");
+        free(results);
+    } else if(strcmp(line, "stats") == 0){
+        //grade histograms, means, medians and overall GPA
+        print_grade_statistics();
+    } else if(strcmp(line, "view") == 0){
+        //view table or view fields
+        trim_string(args);
+        if(strcmp(args, "table") != 0 && strcmp(args, "fields") != 0){
+            return "expected view table or view fields";
+        }
+        TableView = strcmp(args, "table") == 0;
+    } else if(strcmp(line, "prefix") == 0 || strcmp(line, "contains") == 0){
+        //prefix name=Smi or contains email=@mail
+        int *results;
+        n = split_pairs(args, keys, values, 8);
+        if(n != 1 || (strcmp(keys[0], "name") != 0 && strcmp(keys[0], "email") != 0)){
+            return "expected name= or email=";
+        }
+        if(line[0] == 'p'){
+            n = search_prefix(keys[0][0] == 'n' ? FIELD_NAME : FIELD_EMAIL, values[0], &results);
+        } else {
+            n = search_substring(keys[0][0] == 'n' ? FIELD_NAME : FIELD_EMAIL, values[0], &results);
+        }
+        print_results(results, n);
+        free(results);
+    } else if(strcmp(line, "remove") == 0 || strcmp(line, "update") == 0 || strcmp(line, "find") == 0){
+        //first pair selects the student, remaining pairs are new values
+        n = split_pairs(args, keys, values, 8);
+        if(n < 1){
+            return "expected uid=, name= or email=";
+        }
+        trim_string(values[0]);
+        i = select_student(keys[0], values[0]);
+        if(i == -1){
+            return "student does not exist";
+        }
+        if(line[0] == 'r'){
+            delete_student(i);
+        } else if(line[0] == 'f'){
+            s = copy_student(i);
+            print_student(&s, false);
+            flush_output();
+        } else {
+            s = copy_student(i);
+            for(int k = 1; k < n; k++){
+                if((error = set_student_field(&s, keys[k], values[k])) != NULL){
+                    return error;
+                }
             }
-            s.essay = convert_char_to_grade(input[0]);
-            break;
-        case 6:
-            printf("Enter project grade (A, B, C, D, F): ");
-            get_input(input);
-            while(strlen(input) != 1 || convert_char_to_grade(input[0]) == ERR){
-                printf("Invalid grade. Re-enter project grade (A, B, C, D, F): ");
-                get_input(input);
+            if(strcmp(s.id, student_at(i)->id) != 0 && index_lookup(FIELD_UID, s.id) != -1){
+                return "UID already exists";
             }
-            s.project = convert_char_to_grade(input[0]);
-            break;
-        default:
-            printf("Error");
+            replace_student(i, s);
+        }
+    } else {
+        return "unknown command";
     }
-
-    return s;
+    return NULL;
 }
 
 /*
-    function to update student***
+    runs commands from file, or stdin if path is "-", without prompting
+    changes are saved once at the end instead of journaled one by one
 */
-void update_student(){
-    char c, input[BUFFER];
-    printf("...updating student\n");
-
-    //Access array to edit student
-    int arrayIndex = find_student();
-    if (arrayIndex == -1){
+void run_batch(const char *path){
+    FILE *file = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    char line[BUFFER];
+    long lineNumber = 0, commands = 0, failed = 0;
+    double start = seconds_now(), elapsed;
+
+    if(file == NULL){
+        printf("...Unable to open %s\n", path);
         return;
     }
 
-    //Initial Student found from find_student to update
-    student studentToUpdate = Students[arrayIndex];
-
-    //Student After Update
-    student updatedStudent = studentToUpdate;
-
-    //Keep Asking for updates before exiting
-    bool keepRunning = true;
-    while(keepRunning){
-
-        //Pass in True since it will show A, B, C, .. next to entries
-        print_student(updatedStudent, true);
+    while(fgets(line, BUFFER, file) != NULL){
+        const char *error;
 
-        printf("Select an option for which field to update\n");
-        get_input(input);
-        c = input[0];
-        switch(c){
-            case 'A':
-            case 'a':
-                updatedStudent = update_student_field(studentToUpdate, 1);
-                break;
-            case 'B':
-            case 'b':
-                updatedStudent = update_student_field(studentToUpdate, 2);
-                break;
-            case 'C':
-            case 'c':
-                updatedStudent = update_student_field(studentToUpdate, 3);
-                break;
-            case 'D':
-            case 'd':
-                updatedStudent = update_student_field(studentToUpdate, 4);
-                break;
-            case 'E':
-            case 'e':
-                updatedStudent = update_student_field(studentToUpdate, 5);
-                break;
-            case 'F':
-            case 'f':
-                updatedStudent = update_student_field(studentToUpdate, 6);
-                break;
-            case 'G':
-            case 'g':
-                keepRunning = false;
-                break;
+        lineNumber++;
+        trim_string(line);
+        if(line[0] == '\0' || line[0] == '#'){
+            continue;
+        }
+        commands++;
+        if((error = run_batch_command(line)) != NULL){
+            fprintf(stderr, "%s:%ld: %s\n", path, lineNumber, error);
+            failed++;
         }
+
+        //keeps removed slots below CompactRatio
+        compact_students();
+    }
+    if(file != stdin){
+        fclose(file);
     }
 
-    Students[arrayIndex] = updatedStudent;
-    save_student_file();
+    //single save for the whole batch
+    compact_student_file();
 
+    elapsed = seconds_now() - start;
+    printf("...%ld commands (%ld failed) in %.3f seconds", commands, failed, elapsed);
+    if(elapsed > 0){
+        printf(", %.0f commands/second", commands / elapsed);
+    }
+    printf("\n");
 }
 
-
-
-
+/*
+    closes the journal and frees all students and indexes
+*/
+void free_student_file(){
+    if(Journal != NULL){
+        fclose(Journal);
+        Journal = NULL;
+    }
+    free_indexes();
+    free_students();
+}
 
 /* MAIN FUNCTION */
-int main() {
-    //allocate memory
-    Students = (student*)calloc(1, sizeof(student)*max);
-    if (Students == NULL){
-        printf("...memory not allocated\n");
-        return 0;
+int main(int argc, char *argv[]) {
+    //read compaction threshold if given
+    if(getenv("STUDENTS_COMPACT_RATIO") != NULL){
+        CompactRatio = atof(getenv("STUDENTS_COMPACT_RATIO"));
+    }
+
+    if(argc != 1 && !(argc == 3 && strcmp(argv[1], "-b") == 0)){
+        printf("usage: %s [-b <command file or - for stdin>]\n", argv[0]);
+        return 1;
     }
 
     //load students from save file
     load_student_file();
 
+    //run a batch of commands instead of prompting
+    if(argc == 3){
+        run_batch(argv[2]);
+        free_student_file();
+        return 0;
+    }
+
     //display commands initially
     print_commands();
     printf("\n");
 
-    int end = 0;
+    int end = 0, index;
+    student s;
     //while user has not entered command to quit program:
     while(end != 1){
         int valid = 0;
@@ -751,10 +3583,9 @@ int main() {
                 case 'A':
                 case 'a': valid = 1;
                     printf("*****Adding student*****\n");
-                    Students[count] = create_student();
-                    count++;
-                    //reduces amount of reallocations
-                    add_student_memory();
+                    s = create_student();
+                    append_student(s);
+                    journal_write('A', NULL, &s);
                     printf("\n");
                     break;
                 
@@ -774,10 +3605,7 @@ int main() {
                         printf("ERR: No students exist. Enter \"a\" to add a new student.\n");
                         break;
                     }
-                    for (int i = 0; i < count; i++){
-                        print_student(Students[i],false);
-                        printf("\n");
-                    }
+                    print_students(NULL, count);
                     break;
                 
                 //update student
@@ -791,11 +3619,12 @@ int main() {
                 //find student
                 case 'F':
                 case 'f': valid = 1;
-                    int index;
                     printf("*****Finding student*****\n");
                     index = find_student();
                     if(index != -1){
-                        print_student(Students[index],false);
+                        s = copy_student(index);
+                        print_student(&s,false);
+                        flush_output();
                     }
                     printf("\n");
                     break;
@@ -804,11 +3633,89 @@ int main() {
                 case 'Q':
                 case 'q': valid = 1;
                     printf("*****Quitting program*****\n");
-                    save_student_file();
+                    compact_student_file();
                     end = 1;
                     printf("\n");
                     break;
 
+                //import students from CSV
+                case 'I':
+                case 'i': valid = 1;
+                    printf("*****Importing students*****\n");
+                    printf("Enter CSV file name: ");
+                    get_input(input);
+                    if(import_csv(input) == -1){
+                        printf("...Unable to open %s\n", input);
+                    } else {
+                        //one save for the whole import
+                        compact_student_file();
+                    }
+                    printf("\n");
+                    break;
+
+                //export students to CSV
+                case 'E':
+                case 'e': valid = 1;
+                    printf("*****Exporting students*****\n");
+                    printf("Enter CSV file name: ");
+                    get_input(input);
+                    index = export_csv(input);
+                    if(index == -1){
+                        printf("...Unable to write %s\n", input);
+                    } else {
+                        printf("...exported %d students\n", index);
+                    }
+                    printf("\n");
+                    break;
+
+                //search students
+                case 'S':
+                case 's': valid = 1;
+                    printf("*****Searching students*****\n");
+                    search_students();
+                    printf("\n");
+                    break;
+
+                //toggle case-insensitive find and search
+                case 'C':
+                case 'c': valid = 1;
+                    IgnoreCase = !IgnoreCase;
+                    printf("...find and search %s case\n", IgnoreCase ? "ignore" : "match");
+                    printf("\n");
+                    break;
+
+                //toggle listing students as a table
+                case 'T':
+                case 't': valid = 1;
+                    TableView = !TableView;
+                    printf("...students shown %s\n", TableView ? "as a table" : "field by field");
+                    printf("\n");
+                    break;
+
+                //grade statistics
+                case 'G':
+                case 'g': valid = 1;
+                    printf("*****Grade statistics*****\n");
+                    print_grade_statistics();
+                    printf("\n");
+                    break;
+
+                //list students with the highest or lowest grades
+                case 'K':
+                case 'k': valid = 1;
+                    printf("*****Ranking students*****\n");
+                    show_rankings();
+                    printf("\n");
+                    break;
+
+                //list students sorted by a field
+                case 'O':
+                case 'o': valid = 1;
+                    printf("*****Sorting students*****\n");
+                    sort_students();
+                    printf("\n");
+                    break;
+
                 //show commands
                 case 'H':
                 case 'h': valid = 1;
@@ -822,7 +3729,10 @@ int main() {
             }
 
         }while (valid != 1);
+
+        //compact between commands so removal itself stays constant time
+        compact_students();
     }
-    free(Students);
+    free_student_file();
     return 0;
 }
\ No newline at end of file